@@ -15,6 +15,7 @@
 #include "../common/code.h"
 
 #include <string>
+#include <utility>    // std::swap
 #include <cstddef>    // std::size_t
 
 // uncomment the following line to enable debugging messages with DEBUG*
@@ -28,26 +29,32 @@
 // Constructor
 CodeGenVisitor::CodeGenVisitor(TypesMgr       & Types,
                                SymTable       & Symbols,
-                               TreeDecoration & Decorations) :
+                               TreeDecoration & Decorations,
+                               bool             ShortCircuit,
+                               bool             ExtendedISA,
+                               bool             Checked) :
   Types{Types},
   Symbols{Symbols},
-  Decorations{Decorations} {
+  Decorations{Decorations},
+  ShortCircuit{ShortCircuit},
+  ExtendedISA{ExtendedISA},
+  Checked{Checked} {
 }
 
 // Methods to visit each kind of node:
 //
 antlrcpp::Any CodeGenVisitor::visitProgram(AslParser::ProgramContext *ctx) {
   DEBUG_ENTER();
-  code my_code;
+  Program = code();
   SymTable::ScopeId sc = getScopeDecor(ctx);
   Symbols.pushThisScope(sc);
   for (auto ctxFunc : ctx->function()) { 
     subroutine subr = visit(ctxFunc);
-    my_code.add_subroutine(subr);
+    Program.add_subroutine(subr);
   }
   Symbols.popScope();
   DEBUG_EXIT();
-  return my_code;
+  return Program;
 }
 
 antlrcpp::Any CodeGenVisitor::visitFunction(AslParser::FunctionContext *ctx) {
@@ -70,6 +77,8 @@ antlrcpp::Any CodeGenVisitor::visitFunction(AslParser::FunctionContext *ctx) {
   }
   instructionList && code = visit(ctx->statements());
   code = code || instruction::RETURN();
+  code.back().line = ctx->getStop()->getLine();
+  setLine(code, ctx->getStart()->getLine());
   subr.set_instructions(code);
   Symbols.popScope();
   DEBUG_EXIT();
@@ -104,6 +113,8 @@ antlrcpp::Any CodeGenVisitor::visitStatements(AslParser::StatementsContext *ctx)
   instructionList code;
   for (auto stCtx : ctx->statement()) {
     instructionList && codeS = visit(stCtx);
+    // the instructions of the inner statements already have their lines
+    setLine(codeS, stCtx->getStart()->getLine());
     code = code || codeS;
   }
   DEBUG_EXIT();
@@ -133,7 +144,16 @@ antlrcpp::Any CodeGenVisitor::visitAssignStmt(AslParser::AssignStmtContext *ctx)
       code = code || instruction::LOAD(temp1, addr1);
     if (!Symbols.isLocalVarClass(addr2))
       code = code || instruction::LOAD(temp2, addr2);
-    
+    std::string dst = Symbols.isLocalVarClass(addr1) ? addr1 : temp1;
+    std::string src = Symbols.isLocalVarClass(addr2) ? addr2 : temp2;
+    std::string nElems = std::to_string(Types.getArraySize(Symbols.getType(addr1)));
+
+    if (ExtendedISA) {
+      code = code1 || code2 || code || instruction::MEMCPY(dst, src, nElems);
+      DEBUG_EXIT();
+      return code;
+    }
+
     // Creació temporals
     std::string index      = "%"+codeCounters.newTEMP();  
     std::string size       = "%"+codeCounters.newTEMP();
@@ -147,15 +167,15 @@ antlrcpp::Any CodeGenVisitor::visitAssignStmt(AslParser::AssignStmtContext *ctx)
 
     code = code || instruction::ILOAD(index, "0");
     code = code || instruction::ILOAD(increase, UNIT);
-    code = code || instruction::ILOAD(size, std::to_string(Types.getArraySize(Symbols.getType(addr1))));
+    code = code || instruction::ILOAD(size, nElems);
     code = code || instruction::ILOAD(offset, UNIT);
 
     code = code || instruction::LABEL(labelWhile);
     code = code || instruction::LT(comparison, index, size);
     code = code || instruction::FJUMP(comparison, labelEndWhile);
     code = code || instruction::MUL(address, offset, index);
-    code = code || instruction::LOADX(value, Symbols.isLocalVarClass(addr2) ? addr2 : temp2, address);
-    code = code || instruction::XLOAD(Symbols.isLocalVarClass(addr1) ? addr1 : temp1, address, value);
+    code = code || instruction::LOADX(value, src, address);
+    code = code || instruction::XLOAD(dst, address, value);
     code = code || instruction::ADD(index, index, increase);
     code = code || instruction::UJUMP(labelWhile);
     code = code || instruction::LABEL(labelEndWhile);
@@ -180,20 +200,30 @@ antlrcpp::Any CodeGenVisitor::visitAssignStmt(AslParser::AssignStmtContext *ctx)
 antlrcpp::Any CodeGenVisitor::visitIfStmt(AslParser::IfStmtContext *ctx) {
   DEBUG_ENTER();
   instructionList code;
-  CodeAttribs     && codAtsE = visit(ctx->expr());
-  std::string          addr1 = codAtsE.addr;
-  instructionList &    code1 = codAtsE.code;
+  std::string          addr1;
+  instructionList      code1;
+  // the condition is jumping code in short-circuit mode, and when it
+  // can be a compare-and-jump
+  bool jumping = ShortCircuit || (ExtendedISA && isComparison(ctx->expr()));
+  if (!jumping) {
+    CodeAttribs   && codAtsE = visit(ctx->expr());
+    addr1 = codAtsE.addr;
+    code1 = codAtsE.code;
+  }
   instructionList &&   code2 = visit(ctx->statements());
   std::string label = codeCounters.newLabelIF();
   std::string labelEndIf = "endif"+label;
+  std::string labelElse = ctx->elseStat() ? "else"+label : labelEndIf;
+  // the condition jumps to labelElse when it is false
+  if (jumping)
+    code1 = jumpingCode(ctx->expr(), false, labelElse);
+  else
+    code1 = code1 || instruction::FJUMP(addr1, labelElse);
   if (!ctx->elseStat())
-    code = code1 || instruction::FJUMP(addr1, labelEndIf) ||
-           code2 || instruction::LABEL(labelEndIf);
+    code = code1 || code2 || instruction::LABEL(labelEndIf);
   else {
-    std::string labelElse = "else"+label;
     instructionList && code3 = visit(ctx->elseStat()->statements());
-    code = code1 || instruction::FJUMP(addr1, labelElse) ||
-           code2 || instruction::UJUMP(labelEndIf) || instruction::LABEL(labelElse) ||
+    code = code1 || code2 || instruction::UJUMP(labelEndIf) || instruction::LABEL(labelElse) ||
            code3 || instruction::LABEL(labelEndIf);
   }
   DEBUG_EXIT();
@@ -203,15 +233,24 @@ antlrcpp::Any CodeGenVisitor::visitIfStmt(AslParser::IfStmtContext *ctx) {
 antlrcpp::Any CodeGenVisitor::visitWhileStmt(AslParser::WhileStmtContext *ctx) {
   DEBUG_ENTER();
   instructionList code;
-  CodeAttribs     && codAt = visit(ctx->expr());
-  std::string        addr1 = codAt.addr;
-  instructionList &  code1 = codAt.code;
+  std::string        addr1;
+  instructionList    code1;
+  bool jumping = ShortCircuit || (ExtendedISA && isComparison(ctx->expr()));
+  if (!jumping) {
+    CodeAttribs && codAt = visit(ctx->expr());
+    addr1 = codAt.addr;
+    code1 = codAt.code;
+  }
   instructionList && code2 = visit(ctx->statements());
   std::string label = codeCounters.newLabelWHILE();
   std::string labelWhile = "while" + label;
   std::string labelEndWhile = "endWhile" + label;
-  code = instruction::LABEL(labelWhile) || code1 || 
-         instruction::FJUMP(addr1, labelEndWhile) || code2 || 
+  // the condition jumps to labelEndWhile when it is false
+  if (jumping)
+    code1 = jumpingCode(ctx->expr(), false, labelEndWhile);
+  else
+    code1 = code1 || instruction::FJUMP(addr1, labelEndWhile);
+  code = instruction::LABEL(labelWhile) || code1 || code2 || 
          instruction::UJUMP(labelWhile) || instruction::LABEL(labelEndWhile);
   DEBUG_EXIT();
   return code;
@@ -328,6 +367,22 @@ antlrcpp::Any CodeGenVisitor::visitWriteString(AslParser::WriteStringContext *ct
   DEBUG_ENTER();
   instructionList code;
   std::string s = ctx->STRING()->getText();
+  if (ExtendedISA) {
+    // the characters written, with the same escapes as below
+    std::string str;
+    for (int i = 1; i < int(s.size())-1; ++i) {
+      char c = s[i];
+      if (c == '\\' && std::string("nt\"\\").find(s[i+1]) != std::string::npos) {
+        ++i;
+        c = (s[i] == 'n' ? '\n' : s[i] == 't' ? '\t' : s[i]);
+      }
+      str += c;
+    }
+    if (!str.empty())
+      code = instruction::WRITES(Program.add_string(str));
+    DEBUG_EXIT();
+    return code;
+  }
   std::string temp = "%"+codeCounters.newTEMP();
   int i = 1;
   while (i < int(s.size())-1) {
@@ -369,19 +424,19 @@ antlrcpp::Any CodeGenVisitor::visitLeft_expr(AslParser::Left_exprContext *ctx) {
     std::string temp = "%"+codeCounters.newTEMP();
     CodeAttribs     && codAtsE = visit(ctx->expr());
     instructionList &    codeE = codAtsE.code;
-    offset = codAtsE.addr;
-    // Local array
-    if (Symbols.isLocalVarClass(addr1)) {
-      code = code || codeE || instruction::LOAD(temp, UNIT) ||
-             instruction::MUL(temp, offset, temp);
+    CodeAttribs     && codAtsO = offsetCode(codAtsE.addr, temp);
+    codeE = codeE || checkCode(addr1, codAtsE.addr);
+    // Local array (or any array, indexed directly with the extended
+    // instruction set)
+    if (Symbols.isLocalVarClass(addr1) || ExtendedISA) {
+      code = code || codeE || codAtsO.code;
     }
     else {  // Reference array
       std::string temp2 = "%"+codeCounters.newTEMP();
-      code = code || codeE || instruction::LOAD(temp2, addr1) ||
-             instruction::LOAD(temp, UNIT) || instruction::MUL(temp, offset, temp);
+      code = code || codeE || instruction::LOAD(temp2, addr1) || codAtsO.code;
       addr1 = temp2;
     }
-    offset = temp;
+    offset = codAtsO.addr;
   }
   CodeAttribs codAtts(addr1, offset, code);
   DEBUG_EXIT();
@@ -405,15 +460,15 @@ antlrcpp::Any CodeGenVisitor::visitIndexer(AslParser::IndexerContext *ctx) {
   std::string temp1 = "%"+codeCounters.newTEMP();
   std::string temp2 = "%"+codeCounters.newTEMP();
 
-  code = code || instruction::LOAD(temp2, UNIT) || 
-                 instruction::MUL(temp2, offs2, temp2);
+  CodeAttribs     &&  codAtsO = offsetCode(offs2, temp2);
+  code = code || checkCode(addr1, offs2) || codAtsO.code;
 
-  if (Symbols.isLocalVarClass(addr1)) 
-    code = code || instruction::LOADX(temp1, addr1, temp2);
+  if (Symbols.isLocalVarClass(addr1) || ExtendedISA) 
+    code = code || instruction::LOADX(temp1, addr1, codAtsO.addr);
   else {
     std::string temp = "%"+codeCounters.newTEMP();
     code = code || instruction::LOAD(temp, addr1) || 
-                   instruction::LOADX(temp1, temp, temp2);
+                   instruction::LOADX(temp1, temp, codAtsO.addr);
   }
   CodeAttribs codAtts(temp1, "", code);
   DEBUG_EXIT();
@@ -473,7 +528,11 @@ antlrcpp::Any CodeGenVisitor::visitUnary(AslParser::UnaryContext *ctx) {
   std::string temp = "%"+codeCounters.newTEMP();
   TypesMgr::TypeId t = getTypeDecor(ctx);
   
-  if (ctx->SUB())
+  if (ctx->SUB() && ExtendedISA &&
+      (instruction::operandKind(addr) == instruction::_INTIMM ||
+       instruction::operandKind(addr) == instruction::_FLOATIMM))
+    temp = (addr[0] == '-') ? addr.substr(1) : "-" + addr;
+  else if (ctx->SUB())
     code = code || (Types.isIntegerTy(t) ? instruction::NEG (temp, addr) :
                                            instruction::FNEG(temp, addr));
   else if (ctx->NOT())
@@ -508,6 +567,8 @@ antlrcpp::Any CodeGenVisitor::visitArithmetic(AslParser::ArithmeticContext *ctx)
       code = code || instruction::DIV(temp, addr1, addr2);
     else if (ctx->SUB())
       code = code || instruction::SUB(temp, addr1, addr2);
+    else if (ctx->MOD() && ExtendedISA)
+      code = code || instruction::MOD(temp, addr1, addr2);
     else if (ctx->MOD()) {
       std::string temp1 = "%"+codeCounters.newTEMP();
       std::string temp2 = "%"+codeCounters.newTEMP();
@@ -545,83 +606,24 @@ antlrcpp::Any CodeGenVisitor::visitArithmetic(AslParser::ArithmeticContext *ctx)
 
 antlrcpp::Any CodeGenVisitor::visitRelational(AslParser::RelationalContext *ctx) {
   DEBUG_ENTER();
-  CodeAttribs     && codAt1 = visit(ctx->expr(0));
-  std::string         addr1 = codAt1.addr;
-  instructionList &   code1 = codAt1.code;
-  CodeAttribs     && codAt2 = visit(ctx->expr(1));
-  std::string         addr2 = codAt2.addr;
-  instructionList &   code2 = codAt2.code;
-  instructionList &&   code = code1 || code2;
-  TypesMgr::TypeId t1 = getTypeDecor(ctx->expr(0));
-  TypesMgr::TypeId t2 = getTypeDecor(ctx->expr(1));
-  std::string temp = "%"+codeCounters.newTEMP();
-
-  if ((Types.isIntegerTy(t1)   && Types.isIntegerTy(t2)) ||
-      (Types.isCharacterTy(t1) && Types.isCharacterTy(t2))) {
-    if (ctx->SEQ()) 
-      code = code || instruction::EQ(temp, addr1, addr2);
-    else if (ctx->SNEQ()) {
-      std::string temp1 = "%"+codeCounters.newTEMP();
-      code = code || instruction::EQ(temp1, addr1, addr2) ||
-                     instruction::NOT(temp, temp1);
-    }
-    else if (ctx->SLE())
-      code = code || instruction::LE(temp, addr1, addr2);
-    else if (ctx->SLT())
-      code = code || instruction::LT(temp, addr1, addr2);
-    else if (ctx->SGT()) {
-      std::string temp1 = "%"+codeCounters.newTEMP();
-      code = code || instruction::LE(temp1, addr1, addr2) || 
-                     instruction::NOT(temp, temp1);
-    }
-    else {  // ctx->SGE()
-      std::string temp1 = "%"+codeCounters.newTEMP();
-      code = code || instruction::LT(temp1, addr1, addr2) ||
-                     instruction::NOT(temp, temp1);
-    }
-  }
-  else {
-    std::string addr1f = addr1;
-    std::string addr2f = addr2;
-    // Relational operators with coercion int -> float
-    if (Types.isIntegerTy(t1)) {
-      addr1f = "%"+codeCounters.newTEMP();
-      code = code || instruction::FLOAT(addr1f, addr1);
-    }
-    else if (Types.isIntegerTy(t2)) {
-      addr2f = "%"+codeCounters.newTEMP();
-      code = code || instruction::FLOAT(addr2f, addr2);
-    }
-    // Float relations
-    if (ctx->SEQ()) 
-      code = code || instruction::FEQ(temp, addr1f, addr2f);
-    else if (ctx->SNEQ()) {
-      std::string temp1 = "%"+codeCounters.newTEMP();
-      code = code || instruction::FEQ(temp1, addr1f, addr2f) || 
-                     instruction::NOT(temp, temp1);
-    }
-    else if (ctx->SLE())
-      code = code || instruction::FLE(temp, addr1f, addr2f);
-    else if (ctx->SLT())
-      code = code || instruction::FLT(temp, addr1f, addr2f);
-    else if (ctx->SGT()) {
-      std::string temp1 = "%"+codeCounters.newTEMP();
-      code = code || instruction::FLE(temp1, addr1f, addr2f) ||
-                     instruction::NOT(temp, temp1);
-    }
-    else {  // ctx->SGE()
-      std::string temp1 = "%"+codeCounters.newTEMP();
-      code = code || instruction::FLT(temp1, addr1f, addr2f) || 
-                     instruction::NOT(temp, temp1);
-    }
-  }
-  CodeAttribs codAts(temp, "", code);
+  CodeAttribs && codAts = relationalCode(ctx, false);
   DEBUG_EXIT();
   return codAts;
 }
 
 antlrcpp::Any CodeGenVisitor::visitLogical(AslParser::LogicalContext *ctx) {
   DEBUG_ENTER();
+  if (ShortCircuit) {
+    // the value is needed: it is built after the jumping code
+    std::string temp = "%"+codeCounters.newTEMP();
+    std::string labelFalse = "cond"+codeCounters.newLabelCOND();
+    instructionList && code = instruction::ILOAD(temp, "0") ||
+                              jumpingCode(ctx, false, labelFalse) ||
+                              instruction::ILOAD(temp, "1") || instruction::LABEL(labelFalse);
+    CodeAttribs codAts(temp, "", code);
+    DEBUG_EXIT();
+    return codAts;
+  }
   CodeAttribs     && codAt1 = visit(ctx->expr(0));
   std::string         addr1 = codAt1.addr;
   instructionList &   code1 = codAt1.code;
@@ -641,6 +643,15 @@ antlrcpp::Any CodeGenVisitor::visitLogical(AslParser::LogicalContext *ctx) {
 
 antlrcpp::Any CodeGenVisitor::visitValue(AslParser::ValueContext *ctx) {
   DEBUG_ENTER();
+  if (ExtendedISA) {
+    // the constant is an immediate operand of the instruction using it
+    std::string imm = ctx->getText();
+    if (ctx->BOOLVAL())
+      imm = (imm == "true" ? "1" : "0");
+    CodeAttribs codAts(imm, "", instructionList());
+    DEBUG_EXIT();
+    return codAts;
+  }
   instructionList code;
   std::string temp = "%"+codeCounters.newTEMP();
   if (ctx->INTVAL())
@@ -673,6 +684,198 @@ antlrcpp::Any CodeGenVisitor::visitIdent(AslParser::IdentContext *ctx) {
 }
 
 
+// Auxiliary code generation methods
+
+CodeGenVisitor::CodeAttribs CodeGenVisitor::relationalCode(AslParser::RelationalContext *ctx,
+                                                           bool negated,
+                                                           const std::string & label) {
+  CodeAttribs     && codAt1 = visit(ctx->expr(0));
+  std::string         addr1 = codAt1.addr;
+  instructionList &   code1 = codAt1.code;
+  CodeAttribs     && codAt2 = visit(ctx->expr(1));
+  std::string         addr2 = codAt2.addr;
+  instructionList &   code2 = codAt2.code;
+  instructionList &&   code = code1 || code2;
+  TypesMgr::TypeId t1 = getTypeDecor(ctx->expr(0));
+  TypesMgr::TypeId t2 = getTypeDecor(ctx->expr(1));
+  bool jump = !label.empty();
+  std::string temp = jump ? "" : "%"+codeCounters.newTEMP();
+
+  // 'a op b' (or 'not (a op b)') is computed as [not] (x cmp y),
+  // with x, y the operands in the same or reverse order (in
+  // short-circuit mode an int or char a > b is b < a instead of
+  // not (a <= b)). With the extended instruction set any comparison
+  // can be negated (by a compare-and-jump or by the negated
+  // comparison), so then operands are not reversed and the negation
+  // is left to the end. Neither are they for floats: with a NaN
+  // operand not (a <= b) is true but b < a is false
+  bool isFloat = !(Types.isIntegerTy(t1)   && Types.isIntegerTy(t2)) &&
+                 !(Types.isCharacterTy(t1) && Types.isCharacterTy(t2));
+  bool neg = negated && !ExtendedISA && !isFloat;
+  instruction::Operation cmp;
+  bool reverse = false, notCmp = false;
+  if (ctx->SEQ()) {
+    cmp = instruction::_EQ;
+    notCmp = neg;
+  }
+  else if (ctx->SNEQ()) {
+    cmp = instruction::_EQ;
+    notCmp = !neg;
+  }
+  else if (ctx->SLE()) {
+    cmp = neg ? instruction::_LT : instruction::_LE;
+    reverse = neg;
+  }
+  else if (ctx->SLT()) {
+    cmp = neg ? instruction::_LE : instruction::_LT;
+    reverse = neg;
+  }
+  else if (ctx->SGT() && ShortCircuit && !ExtendedISA && !neg && !isFloat) {
+    cmp = instruction::_LT;
+    reverse = true;
+  }
+  else if (ctx->SGT()) {
+    cmp = instruction::_LE;
+    notCmp = !neg;
+  }
+  else if (ShortCircuit && !ExtendedISA && !neg && !isFloat) {  // ctx->SGE()
+    cmp = instruction::_LE;
+    reverse = true;
+  }
+  else {  // ctx->SGE()
+    cmp = instruction::_LT;
+    notCmp = !neg;
+  }
+  if (negated && !ExtendedISA && isFloat)
+    notCmp = !notCmp;
+
+  if (isFloat) {
+    // Relational operators with coercion int -> float
+    if (Types.isIntegerTy(t1)) {
+      std::string temp1 = "%"+codeCounters.newTEMP();
+      code = code || instruction::FLOAT(temp1, addr1);
+      addr1 = temp1;
+    }
+    else if (Types.isIntegerTy(t2)) {
+      std::string temp2 = "%"+codeCounters.newTEMP();
+      code = code || instruction::FLOAT(temp2, addr2);
+      addr2 = temp2;
+    }
+    cmp = (cmp == instruction::_EQ ? instruction::_FEQ :
+           cmp == instruction::_LT ? instruction::_FLT : instruction::_FLE);
+  }
+  if (reverse)
+    std::swap(addr1, addr2);
+  if (jump) {
+    // the value is x cmp y, negated if notCmp != negated: the jump is
+    // taken when it is false
+    instruction::Operation op =
+      (cmp == instruction::_EQ  ? instruction::_IFEQ  : cmp == instruction::_LT  ? instruction::_IFLT :
+       cmp == instruction::_LE  ? instruction::_IFLE  : cmp == instruction::_FEQ ? instruction::_IFFEQ :
+       cmp == instruction::_FLT ? instruction::_IFFLT : instruction::_IFFLE);
+    if (notCmp == negated)
+      op = instruction::negatedJump(op);
+    code = code || instruction(op, addr1, addr2, label);
+    CodeAttribs codAts("", "", code);
+    return codAts;
+  }
+  if (ExtendedISA) {
+    if (notCmp != negated)
+      cmp = instruction::negatedCompare(cmp);
+    notCmp = false;
+  }
+  std::string result = notCmp ? "%"+codeCounters.newTEMP() : temp;
+  code = code || instruction(cmp, result, addr1, addr2);
+  if (notCmp)
+    code = code || instruction::NOT(temp, result);
+  CodeAttribs codAts(temp, "", code);
+  return codAts;
+}
+
+CodeGenVisitor::CodeAttribs CodeGenVisitor::offsetCode(const std::string & index,
+                                                       const std::string & temp) {
+  instructionList code;
+  if (ExtendedISA) {
+    CodeAttribs codAts(index, "", code);
+    return codAts;
+  }
+  code = instruction::LOAD(temp, UNIT) || instruction::MUL(temp, index, temp);
+  CodeAttribs codAts(temp, "", code);
+  return codAts;
+}
+
+instructionList CodeGenVisitor::checkCode(const std::string & array,
+                                          const std::string & index) {
+  instructionList code;
+  if (Checked) {
+    std::string size = std::to_string(Types.getArraySize(Symbols.getType(array)));
+    code = instruction::CHECK(index, size);
+  }
+  return code;
+}
+
+bool CodeGenVisitor::isComparison(AslParser::ExprContext *ctx) const {
+  auto ctxPar = dynamic_cast<AslParser::ParenthesisContext *>(ctx);
+  auto ctxUna = dynamic_cast<AslParser::UnaryContext *>(ctx);
+  if (ctxPar)
+    return isComparison(ctxPar->expr());
+  if (ctxUna && ctxUna->NOT())
+    return isComparison(ctxUna->expr());
+  return dynamic_cast<AslParser::RelationalContext *>(ctx) != nullptr;
+}
+
+instructionList CodeGenVisitor::jumpingCode(AslParser::ExprContext *ctx, bool when,
+                                            const std::string & label) {
+  instructionList code;
+  auto ctxPar = dynamic_cast<AslParser::ParenthesisContext *>(ctx);
+  auto ctxUna = dynamic_cast<AslParser::UnaryContext *>(ctx);
+  auto ctxLog = dynamic_cast<AslParser::LogicalContext *>(ctx);
+  auto ctxRel = dynamic_cast<AslParser::RelationalContext *>(ctx);
+  if (ctxPar)
+    code = jumpingCode(ctxPar->expr(), when, label);
+  else if (ctxUna && ctxUna->NOT())
+    code = jumpingCode(ctxUna->expr(), !when, label);
+  else if (ctxLog) {
+    // the value decided by the first operand alone ('and': false, 'or': true)
+    bool decided = ctxLog->OR() != nullptr;
+    if (when == decided)
+      code = jumpingCode(ctxLog->expr(0), when, label) ||
+             jumpingCode(ctxLog->expr(1), when, label);
+    else {
+      std::string labelSkip = "cond"+codeCounters.newLabelCOND();
+      code = jumpingCode(ctxLog->expr(0), decided, labelSkip) ||
+             jumpingCode(ctxLog->expr(1), when, label) || instruction::LABEL(labelSkip);
+    }
+  }
+  else if (ctxRel) {
+    // ifFalse jumps when the value is false: to jump when it is true
+    // the negated comparison is computed (or it is a single
+    // compare-and-jump with the extended instruction set)
+    CodeAttribs && codAt = relationalCode(ctxRel, when, ExtendedISA ? label : "");
+    code = codAt.code;
+    if (!ExtendedISA)
+      code = code || instruction::FJUMP(codAt.addr, label);
+  }
+  else {
+    CodeAttribs && codAt = visit(ctx);
+    std::string addr = codAt.addr;
+    code = codAt.code;
+    if (when) {
+      std::string temp = "%"+codeCounters.newTEMP();
+      code = code || instruction::NOT(temp, addr);
+      addr = temp;
+    }
+    code = code || instruction::FJUMP(addr, label);
+  }
+  return code;
+}
+
+void CodeGenVisitor::setLine(instructionList & code, std::size_t line) const {
+  for (auto & inst : code)
+    if (inst.line == 0) inst.line = line;
+}
+
+
 // Getters for the necessary tree node atributes:
 //   Scope and Type
 SymTable::ScopeId CodeGenVisitor::getScopeDecor(antlr4::ParserRuleContext *ctx) const {
@@ -30,6 +30,50 @@
 // computed and decorate the parse tree. In this visit, if some node/method
 // does not have an associated task, it does not have to be visited/called
 // so no redefinition is needed.
+//
+// Boolean expressions are evaluated completely by default (both
+// operands of 'and'/'or' are computed, left to right, and then
+// combined). In short-circuit mode the conditions of if and while
+// statements generate jumping code instead: the second operand of an
+// 'and' ('or') is not evaluated when the first one is false (true),
+// and comparisons jump directly to the target label without computing
+// a boolean when possible (also, an int or char a > b is computed as
+// b < a, and a negated one as the reverse comparison; float ones are
+// computed as in the other modes, e.g. a > b as not (a <= b), since
+// with a NaN operand that is not b < a). So calls in the second
+// operand are not made in that case, and neither are their side
+// effects (writes, reads, changes to array parameters). An 'and'/'or'
+// whose value is needed (e.g. b = x and f(y);) is also
+// short-circuited, and the boolean is built at the end.
+//
+// The instructions generated are the ones understood by the stock tvm
+// unless the extended instruction set is enabled (ExtendedISA, option
+// --isa=ext), see instruction::Operation. Then:
+//   - array assignments (a = b) copy the array with a single memcpy
+//     instead of a loop over its elements,
+//   - a comparison that decides an if or while (also if it is negated
+//     or in parentheses), or any comparison in jumping code, becomes a
+//     single compare-and-jump (e.g. iflt a b goto L) instead of the
+//     comparison, maybe a not, and an ifFalse,
+//   - %, !=, > and >= have their own instructions (a = b % c,
+//     a = b != c, a = b > c, a = b >= c, and the float comparisons
+//     !=., >., >=.) instead of being expanded into div/mul/sub or a
+//     comparison plus a not,
+//   - write "..." writes the whole string with a single writes,
+//     which refers to the string pool of the program,
+//   - constants are immediate operands of the instructions that use
+//     them (e.g. a = b + 1, x[2] = 'c', iflt i 10 goto L) instead of
+//     being loaded into a temporal first,
+//   - an array access (a[i] = x, x = a[i]) is a single instruction:
+//     the index is the one of the element (the VM multiplies it by
+//     the element size), and array parameters are indexed directly
+//     instead of loading their address into a temporal first.
+//
+// In checked mode (Checked, option --checked) every access to an
+// element of an array is preceded by a bounds check of the index
+// (check i n, an instruction of the extended set, which stops the
+// program if i is not in [0, n)), so it implies the extended
+// instruction set. RangeAnalysis removes the ones that can not fail.
 
 class CodeGenVisitor final : public AslBaseVisitor {
 
@@ -38,7 +82,10 @@ public:
   // Constructor
   CodeGenVisitor(TypesMgr       & Types,
 		 SymTable       & Symbols,
-		 TreeDecoration & Decorations);
+		 TreeDecoration & Decorations,
+		 bool             ShortCircuit = false,
+		 bool             ExtendedISA = false,
+		 bool             Checked = false);
 
   // Methods to visit each kind of node:
   antlrcpp::Any visitProgram(AslParser::ProgramContext *ctx);
@@ -73,6 +120,12 @@ private:
   SymTable        & Symbols;
   TreeDecoration  & Decorations;
   counters          codeCounters;
+  bool              ShortCircuit;
+  bool              ExtendedISA;
+  bool              Checked;
+  // program being generated (its string pool is filled while the
+  // subroutines are visited)
+  code              Program;
 
   // Getters for the necessary tree node atributes:
   //   Scope and Type
@@ -107,5 +160,29 @@ private:
     instructionList code;
 
   };  // class CodeAttribs
-  
+
+  // Code for a relational expression that leaves in a temporal its
+  // value (or the negated value, if 'negated'). With a 'label'
+  // (extended instruction set) it is a compare-and-jump to the label
+  // taken when that value is false, and no temporal is left
+  CodeAttribs relationalCode(AslParser::RelationalContext *ctx, bool negated,
+                             const std::string & label = "");
+  // Code for the offset of element 'index' of an array (index * UNIT),
+  // computed in 'temp'. With the extended instruction set it is the
+  // index itself, without code (the VM scales it)
+  CodeAttribs offsetCode(const std::string & index, const std::string & temp);
+  // Bounds check of 'index' as an index of 'array' (no code if not in
+  // checked mode)
+  instructionList checkCode(const std::string & array, const std::string & index);
+  // Whether ctx is a comparison, maybe negated or in parentheses
+  bool isComparison(AslParser::ExprContext *ctx) const;
+  // Jumping code (short-circuit mode, or a comparison with the
+  // extended instruction set) for the condition ctx: jumps to 'label'
+  // when the condition is equal to 'when', falls through otherwise
+  instructionList jumpingCode(AslParser::ExprContext *ctx, bool when,
+                              const std::string & label);
+  // Set the source line of the instructions of 'code' that do not have
+  // one yet (the line of the statement or function that generates them)
+  void setLine(instructionList & code, std::size_t line) const;
+
 };  // class CodeGenVisitor
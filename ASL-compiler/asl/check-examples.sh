@@ -1,62 +1,126 @@
 #!/bin/bash
 
-echo "BEGIN examples-initial/typecheck"
-for f in ../examples/jpbasic_chkt_*.asl; do
-    echo $(basename "$f")
-    ./asl "$f" | egrep ^L > tmp.err
-    diff tmp.err "${f/asl/err}"
-    rm -f tmp.err
-done
-echo "END   examples-initial/typecheck"
+# Runs the examples: type checking, and execution of the generated code
+# (as is, optimized, and with short-circuit conditions) in the tvm and
+# translated to C (asl --emit=c, compiled with $CC, by default cc).
+#
+#   ./check-examples.sh [-j <jobs>] [--shard <k>/<n>] [--examples <dir>]
+#
+# The cases run in parallel (-j, by default as many as processors), each
+# one in its own temporary directory. The results are shown in order:
+# the name of each case, its time and the differences with the expected
+# output, followed by a summary. With --shard k/n only the k-th of every
+# n cases of each group runs (k from 1 to n), to split a big corpus
+# (--examples) between several runs.
 
-echo ""
-echo "BEGIN examples-full/typecheck"
-for f in ../examples/jp_chkt_*.asl; do
-    echo $(basename $f)
-    ./asl $f | egrep ^L > tmp.err
-    diff tmp.err ${f/asl/err}
-    rm -f tmp.err
+jobs=$(nproc 2>/dev/null || sysctl -n hw.ncpu 2>/dev/null || echo 1)
+shard=1/1
+examples=../examples
+while [ $# -gt 0 ]; do
+    case "$1" in
+        -j)         jobs="$2"; shift 2 ;;
+        --shard)    shard="$2"; shift 2 ;;
+        --examples) examples="$2"; shift 2 ;;
+        *)  echo "Usage: ./check-examples.sh [-j <jobs>] [--shard <k>/<n>] [--examples <dir>]"
+            exit 1 ;;
+    esac
 done
-echo "END   examples-full/typecheck"
-
-#echo ""
-#echo "BEGIN examples-initial/codegen"
-#for f in ../examples/jpbasic_genc_*.asl; do
-#    echo $(basename $f)
-#    ./asl $f | egrep -v '^\(' > tmp.t
-#    diff tmp.t ${f/asl/t}
-#    rm -f tmp.t
-#done
-
-#echo "END   examples-initial/codegen"
-# echo ""
-# echo "BEGIN examples-full/codegen"
-# for f in ../examples/jp_genc_*.asl; do
-#     echo $(basename "$f")
-#     ./asl "$f" > tmp.t
-#     diff tmp.t "${f/asl/t}"
-#     rm -f tmp.t
-# done
-# echo "END   examples-full/codegen"
-
-#echo ""
-#echo "BEGIN examples-initial/execution"
-#for f in ../examples/jpbasic_genc_*.asl; do
-#    echo $(basename "$f")
-#    ./asl "$f" > tmp.t
-#    ../tvm/tvm tmp.t < "${f/asl/in}" > tmp.out
-#    diff tmp.out "${f/asl/out}"
-#    rm -f tmp.t tmp.out
-#done
-#echo "END   examples-initial/execution"
+
+export ASL="$(pwd)/asl"
+export TVM="$(pwd)/../tvm/tvm"
+export CC="${CC:-cc}"
+export RESULTS=$(mktemp -d)
+trap 'rm -rf "$RESULTS"' EXIT
+examples=$(cd "$examples" && pwd)
+
+# run_case <group> <kind> <asl options> <tag> <file.asl>: runs a case
+# (kind typecheck, execution in the tvm, native: execution of the C
+# translation, whose errors are part of its output, or ranges: the
+# bounds checks removed, as reported by --stats, against <file>.stats)
+# and leaves in $RESULTS/<group>/ its result. The expected output is <file>.<tag>.out
+# if there is one (the output changes with the options), else <file>.out
+run_case() {
+    local group="$1" kind="$2" opts="$3" tag="$4" f="$5"
+    local out="$RESULTS/$group/$(basename "$f")" dir=$(mktemp -d)
+    local expected="${f%.asl}.out"
+    [ -n "$tag" ] && [ -e "${f%.asl}.$tag.out" ] && expected="${f%.asl}.$tag.out"
+    local TIMEFORMAT=%R
+    {
+        time {
+            cd "$dir"
+            if [ "$kind" = typecheck ]; then
+                "$ASL" "$f" | egrep ^L > tmp.err
+                diff tmp.err "${f%.asl}.err" > "$out.diff"
+            elif [ "$kind" = ranges ]; then
+                "$ASL" $opts "$f" 2>&1 > /dev/null | egrep ^range: > tmp.stats
+                diff tmp.stats "${f%.asl}.stats" > "$out.diff"
+            elif [ "$kind" = native ]; then
+                "$ASL" --emit=c $opts "$f" > tmp.c
+                "$CC" -O2 -o tmp tmp.c
+                ./tmp < "${f%.asl}.in" > tmp.out 2>&1
+                diff tmp.out "$expected" > "$out.diff"
+            else
+                "$ASL" $opts "$f" > tmp.t
+                "$TVM" tmp.t < "${f%.asl}.in" > tmp.out
+                diff tmp.out "$expected" > "$out.diff"
+            fi
+            echo $? > "$out.status"
+        }
+    } 2> "$out.time"
+    rm -rf "$dir"
+}
+export -f run_case
+
+# group <name> <kind> <asl options> <pattern> [<tag>]
+group=0
+group() {
+    local name="$1" kind="$2" opts="$3" pattern="$4" tag="$5" k=${shard%/*} n=${shard#*/} i=0
+    group=$((group+1))
+    mkdir -p "$RESULTS/$group"
+    local files=()
+    for f in "$examples"/$pattern; do
+        [ -e "$f" ] && [ $((i++ % n)) -eq $((k-1)) ] && files+=("$f")
+    done
+    [ ${#files[@]} -eq 0 ] && return
+
+    printf "%s\n" "${files[@]}" |
+        xargs -P "$jobs" -I{} bash -c 'run_case "$@"' _ "$group" "$kind" "$opts" "$tag" {}
+
+    echo ""
+    echo "BEGIN $name"
+    for f in "${files[@]}"; do
+        local out="$RESULTS/$group/$(basename "$f")"
+        printf "%-24s %6ss\n" "$(basename "$f")" "$(tail -1 "$out.time")"
+        cat "$out.diff"
+        if [ "$(cat "$out.status")" = 0 ]; then
+            passed=$((passed+1))
+        else
+            failed+=("$name/$(basename "$f")")
+        fi
+    done
+    echo "END   $name"
+}
+
+passed=0
+failed=()
+start=$SECONDS
+
+group "examples-initial/typecheck" typecheck "" "jpbasic_chkt_*.asl"
+group "examples-full/typecheck"    typecheck "" "jp_chkt_*.asl"
+# group "examples-initial/execution" execution "" "jpbasic_genc_*.asl"
+group "examples-full/execution"    execution "" "jp_genc_*.asl"
+group "examples-full/execution (optimized)"     execution "-O" "jp_genc_*.asl"
+group "examples-full/execution (short-circuit)" execution "--short-circuit -O" "jp_genc_*.asl" sc
+group "examples-full/execution (C)"             native "" "jp_genc_*.asl"
+group "examples-full/execution (C, optimized)"  native "-O" "jp_genc_*.asl"
+group "examples-full/execution (C, extended)"   native "--isa=ext -O" "jp_genc_*.asl"
+group "examples-bounds/execution (C)"            native "--checked" "jp_bounds_*.asl"
+group "examples-bounds/execution (C, optimized)" native "--checked -O" "jp_bounds_*.asl"
+group "examples-bounds/checks removed"           ranges "--checked -O --stats" "jp_bounds_*.asl"
 
 echo ""
-echo "BEGIN examples-full/execution"
-for f in ../examples/jp_genc_*.asl; do
-    echo $(basename "$f")
-    ./asl "$f" > tmp.t
-    ../tvm/tvm tmp.t < "${f/asl/in}" > tmp.out
-    diff tmp.out "${f/asl/out}"
-    rm -f tmp.t tmp.out
+echo "passed $passed of $((passed + ${#failed[@]})) cases in $((SECONDS - start))s ($jobs jobs, shard $shard)"
+for c in "${failed[@]}"; do
+    echo "FAILED $c"
 done
-echo "END   examples-full/execution"
+[ ${#failed[@]} -eq 0 ]
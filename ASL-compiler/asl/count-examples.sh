@@ -0,0 +1,19 @@
+#!/bin/bash
+
+# Dynamic counts of the full examples, without and with -O:
+# executed instructions and executed jumps (goto, ifFalse)
+
+count() {
+    ../tvm/tvm tmp.t --debug < "$1" 2>&1 > /dev/null | egrep "VM_DEBUG: +PC=" > tmp.trace
+    echo "$(wc -l < tmp.trace) $(egrep -c 'goto' tmp.trace)"
+}
+
+printf "%-16s %10s %10s %10s %10s\n" "" "instr" "instr -O" "jumps" "jumps -O"
+for f in ../examples/jp_genc_*.asl; do
+    ./asl "$f" > tmp.t
+    read i0 j0 <<< "$(count "${f%.asl}.in")"
+    ./asl -O "$f" > tmp.t
+    read i1 j1 <<< "$(count "${f%.asl}.in")"
+    printf "%-16s %10d %10d %10d %10d\n" "$(basename "$f" .asl)" $i0 $i1 $j0 $j1
+    rm -f tmp.t tmp.trace
+done
@@ -19,12 +19,25 @@
 #include "TypeCheckVisitor.h"
 #include "../common/code.h"
 #include "CodeGenVisitor.h"
+#include "../common/Inliner.h"
+#include "../common/DeadFunctions.h"
+#include "../common/TailCalls.h"
+#include "../common/ValueNumbering.h"
+#include "../common/LoopInvariant.h"
+#include "../common/RangeAnalysis.h"
+#include "../common/LoopRotation.h"
+#include "../common/Peephole.h"
+#include "../common/CallResolver.h"
+#include "../common/CTranslator.h"
 
 #include <iostream>
-#include <fstream>    // ifstream
+#include <fstream>    // ifstream, ofstream
+#include <string>
 
 #include <cstdio>     // fopen
-#include <cstdlib>    // EXIT_FAILURE, EXIT_SUCCESS
+#include <cstdlib>    // EXIT_FAILURE, EXIT_SUCCESS, atoi
+#include <cctype>     // isdigit
+#include <cstddef>    // std::size_t
 
 // using namespace std;
 // using namespace antlr4;
@@ -32,20 +45,72 @@
 
 int main(int argc, const char* argv[]) {
   // check the correct use of the program
-  if (argc > 2) {
-    std::cout << "Usage: ./main [<file>]" << std::endl;
+  bool optimize = false;     // -O      : optimize the generated code
+  bool stats    = false;     // --stats : report what the optimizer did
+  bool shortCircuit = false; // --short-circuit : and/or conditions do not
+                             //   evaluate the second operand if not needed
+  bool extendedISA  = false; // --isa=ext : use the extended instruction set
+                             //   (--isa=tvm, the default: only the stock tvm one)
+  bool isaGiven     = false; //   (whether it has been given)
+  bool checked      = false; // --checked : bounds checks in the array accesses
+                             //   (extended instructions: implies --isa=ext)
+  bool emitC        = false; // --emit=c : write a C program instead of the
+                             //   t-code (--emit=t, the default)
+  std::size_t inlineThreshold = 20;   // --inline-threshold <n> : size of the
+                                      // subroutines inlined (0: none)
+  const char * linesFile = nullptr;   // --lines <file> : write there the source
+                                      // line of each instruction (profile.sh)
+  const char * callGraphFile = nullptr;   // --call-graph <file> : write there
+                                          // the call graph (Graphviz dot)
+  const char * fileName = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-O")
+      optimize = true;
+    else if (arg == "--stats")
+      stats = true;
+    else if (arg == "--short-circuit")
+      shortCircuit = true;
+    else if (arg == "--isa=ext" || arg == "--isa=tvm") {
+      extendedISA = (arg == "--isa=ext");
+      isaGiven = true;
+    }
+    else if (arg == "--checked")
+      checked = true;
+    else if (arg == "--emit=c" || arg == "--emit=t")
+      emitC = (arg == "--emit=c");
+    else if (arg == "--inline-threshold" && i+1 < argc &&
+             std::isdigit(argv[i+1][0]))
+      inlineThreshold = std::atoi(argv[++i]);
+    else if (arg == "--lines" && i+1 < argc)
+      linesFile = argv[++i];
+    else if (arg == "--call-graph" && i+1 < argc)
+      callGraphFile = argv[++i];
+    else if (arg[0] != '-' && !fileName)
+      fileName = argv[i];
+    else {
+      std::cout << "Usage: ./main [-O] [--stats] [--inline-threshold <n>]"
+                   " [--short-circuit] [--isa=tvm|ext] [--checked] [--emit=t|c]"
+                   " [--lines <file>] [--call-graph <file>] [<file>]" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if (checked && isaGiven && !extendedISA) {
+    std::cout << "Option --checked needs the extended instruction set (--isa=ext)" << std::endl;
     return EXIT_FAILURE;
   }
-  if (argc == 2 && !std::fopen(argv[1], "r")) {
-    std::cout << "No such file: " << argv[1] << std::endl;
+  if (checked)
+    extendedISA = true;
+  if (fileName && !std::fopen(fileName, "r")) {
+    std::cout << "No such file: " << fileName << std::endl;
     return EXIT_FAILURE;
   }
 
   // open input file (or std::cin) and create a character stream
   antlr4::ANTLRInputStream input;
-  if (argc == 2) {  // read from <file>
+  if (fileName) {   // read from <file>
     std::ifstream stream;
-    stream.open(argv[1]);
+    stream.open(fileName);
     input = antlr4::ANTLRInputStream(stream);
   }
   else {            // read fron std::cin
@@ -96,11 +161,70 @@ int main(int argc, const char* argv[]) {
 
   // create a third visitor that will return the generated code
   // for each part of the tree, and will store it in 'mycode'
-  CodeGenVisitor codegenerator(types, symbols, decorations);
+  CodeGenVisitor codegenerator(types, symbols, decorations, shortCircuit, extendedISA,
+                               checked);
   code mycode = codegenerator.visit(tree);
 
-  // print generated code as output
-  std::cout << mycode.dump() << std::endl;
+  // optimize the generated code (statistics go to std::cerr so that
+  // they do not get mixed with the t-code)
+  if (optimize) {
+    Inliner        inliner(inlineThreshold);
+    DeadFunctions  deadFunctions;
+    TailCalls      tailCalls(extendedISA);
+    ValueNumbering lvn;
+    LoopInvariant  licm;
+    RangeAnalysis  ranges;
+    LoopRotation   rotation;
+    Peephole       peephole;
+    inliner.optimize(mycode);
+    // the subroutines whose calls have all been inlined, and the ones
+    // never called from main
+    deadFunctions.optimize(mycode);
+    // the tail-recursive subroutines (not inlined) become loops, which
+    // the next passes can improve
+    tailCalls.optimize(mycode);
+    lvn.optimize(mycode);
+    licm.optimize(mycode);
+    // while the conditions of the loops are still at their top
+    ranges.optimize(mycode);
+    // after hoisting, so that the copy of the condition at the bottom
+    // of the loop does not repeat the invariant part
+    rotation.optimize(mycode);
+    // constants hoisted from different loops may be the same
+    lvn.optimize(mycode);
+    peephole.optimize(mycode);
+    if (stats)
+      std::cerr << inliner.dumpStats() << deadFunctions.dumpStats() << tailCalls.dumpStats()
+                << lvn.dumpStats() << licm.dumpStats() << ranges.dumpStats()
+                << rotation.dumpStats() << peephole.dumpStats();
+  }
+
+  // every call has to reach a subroutine of the program
+  CallResolver calls;
+  bool resolved = calls.resolve(mycode);
+  if (stats || !resolved)
+    std::cerr << calls.dumpStats();
+  if (!resolved) {
+    std::cout << "There are unresolved calls: no code generated." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (callGraphFile) {
+    std::ofstream graph(callGraphFile);
+    graph << calls.dumpCallGraph();
+  }
+
+  // the lines of the final code, after the optimizations
+  if (linesFile) {
+    std::ofstream lines(linesFile);
+    lines << mycode.dumpLines();
+  }
+
+  // print generated code as output (or its translation to C, to be
+  // compiled to a native executable)
+  if (emitC)
+    std::cout << CTranslator().translate(mycode);
+  else
+    std::cout << mycode.dump() << std::endl;
 
   return EXIT_SUCCESS;
 }
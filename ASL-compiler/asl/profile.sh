@@ -0,0 +1,104 @@
+#!/bin/bash
+
+# Execution profile of an ASL program, from the trace of the tvm
+# (--debug): executed instructions per subroutine (calls, exclusive
+# and inclusive counts), per source line of the program and per basic
+# block of the t-code
+#
+#   ./profile.sh [asl options] ../examples/jp_genc_XX.asl < ../examples/jp_genc_XX.in
+
+if [ $# -lt 1 ]; then
+    echo "Usage: ./profile.sh [asl options] <file.asl> < <input>"
+    exit 1
+fi
+program="${!#}"
+
+./asl --lines tmp.lines "$@" > tmp.t || { cat tmp.t; rm -f tmp.t tmp.lines; exit 1; }
+../tvm/tvm tmp.t --debug 2>&1 > /dev/null |
+    egrep "VM_DEBUG: (Entering|Exiting| +PC=[0-9]+\. )" | egrep -v "return found$" > tmp.trace
+
+awk '
+# the t-code: instructions of each subroutine, and the first ones of
+# the basic blocks
+file == 1 && $1 == "function"    { f = $2; pc = 0; jump = 1; next }
+file == 1 && $1 ~ /^(params|vars|strings)$/ { skip = 1; next }
+file == 1 && $1 ~ /^end(params|vars|strings)$/ { skip = 0; next }
+file == 1 && ($1 == "endfunction" || NF == 0 || skip) { next }
+file == 1 {
+    sub(/^ +/, "")
+    if (jump || $1 == "label") leader[f, pc] = 1
+    jump = ($1 == "goto" || $1 == "ifFalse" || $1 == "return" || $1 ~ /^if/ || $1 == "tailcall")
+    size[f] = ++pc
+    next
+}
+
+# source line of each instruction (asl --lines)
+file == 2 { line[$1, $2] = $3; next }
+
+# the trace
+file == 3 && /Entering/ {
+    g = $3; sub(/\.$/, "", g)
+    stack[++depth] = g; entry[depth] = steps
+    ++calls[g]
+    ++active[g]
+    next
+}
+file == 3 && /Exiting/ { leave(); next }
+file == 3 {
+    pc = $2; sub(/^PC=/, "", pc); sub(/\.$/, "", pc)
+    ++count[stack[depth], pc]; ++exclusive[stack[depth]]; ++steps
+    next
+}
+
+# the program, to show the lines
+file == 4 { source[FNR] = $0 }
+
+# recursive calls are only counted once in the inclusive counts
+function leave(  g) {
+    g = stack[depth]
+    if (--active[g] == 0) inclusive[g] += steps - entry[depth]
+    --depth
+}
+
+END {
+    while (depth > 0) leave()
+    printf "%-24s %12d\n\n", "executed instructions", steps
+
+    printf "%-24s %8s %12s %12s\n", "subroutine", "calls", "exclusive", "inclusive"
+    sorted = "sort -k4,4nr -k1,1"
+    for (g in calls)
+        printf "%-24s %8d %12d %12d\n", g, calls[g], exclusive[g], inclusive[g] | sorted
+    close(sorted)
+
+    # instructions without a line (created by the optimizer) belong to
+    # the line of the previous one
+    for (g in size) {
+        l = 0
+        for (pc = 0; pc < size[g]; ++pc) {
+            if ((g, pc) in line) l = line[g, pc]
+            atLine[g, pc] = l
+            perLine[l] += count[g, pc]
+        }
+    }
+    printf "\n%-6s %12s %7s  %s\n", "line", "instructions", "%", "source"
+    sorted = "sort -k2,2nr -k1,1n"
+    for (l in perLine)
+        if (perLine[l] > 0)
+            printf "%-6d %12d %6.2f%%  %s\n", l, perLine[l], 100 * perLine[l] / steps, source[l] | sorted
+    close(sorted)
+
+    printf "\n%-24s %-9s %6s %12s %12s\n", "basic block", "pcs", "line", "executions", "instructions"
+    sorted = "sort -k5,5nr -k1,1"
+    for (g in size)
+        for (pc = 0; pc < size[g]; pc = end) {
+            total = 0
+            for (end = pc; end < size[g] && (end == pc || !((g, end) in leader)); ++end)
+                total += count[g, end]
+            if (total > 0)
+                printf "%-24s %-9s %6d %12d %12d\n", g, pc "-" end - 1, atLine[g, pc], count[g, pc], total | sorted
+        }
+    close(sorted)
+}
+' file=1 tmp.t file=2 tmp.lines file=3 tmp.trace file=4 "$program"
+
+rm -f tmp.t tmp.lines tmp.trace
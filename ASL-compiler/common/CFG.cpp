@@ -0,0 +1,164 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    CFG - Control flow graph (basic blocks) of the instruction
+//          list of a subroutine
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "CFG.h"
+
+#include <algorithm>  // std::find, std::sort
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+// ======================================================================
+// class CFG
+
+// ----------------------------------------------------------------------
+// constructor
+
+CFG::CFG(const instructionList & lins) :
+  blockOf(lins.size()) {
+  // find the leaders and build the blocks
+  for (std::size_t i = 0; i < lins.size(); ++i) {
+    bool leader = (i == 0 or lins[i].oper == instruction::_LABEL or
+                   lins[i-1].isJump());
+    // consecutive labels belong to the same block
+    if (leader and i > 0 and lins[i].oper == instruction::_LABEL and
+        lins[i-1].oper == instruction::_LABEL)
+      leader = false;
+    if (leader) {
+      if (not blocks.empty()) blocks.back().last = i;
+      blocks.push_back(BasicBlock{i, lins.size(), {}, {}});
+    }
+    blockOf[i] = blocks.size()-1;
+    if (lins[i].oper == instruction::_LABEL)
+      labelBlock[lins[i].arg1] = blocks.size()-1;
+  }
+
+  // link them
+  for (std::size_t b = 0; b < blocks.size(); ++b) {
+    const instruction & lastInst = lins[blocks[b].last-1];
+    if (lastInst.oper == instruction::_UJUMP)
+      addEdge(b, labelBlock.at(lastInst.arg1));
+    else if (lastInst.isReturn())
+      continue;
+    else {
+      if (lastInst.isCondJump())
+        addEdge(b, labelBlock.at(lastInst.jumpTarget()));
+      if (b+1 < blocks.size())
+        addEdge(b, b+1);
+    }
+  }
+
+  computeDominators();
+}
+
+void CFG::addEdge(std::size_t from, std::size_t to) {
+  std::vector<std::size_t> & succs = blocks[from].succs;
+  if (std::find(succs.begin(), succs.end(), to) != succs.end()) return;
+  succs.push_back(to);
+  blocks[to].preds.push_back(from);
+}
+
+void CFG::computeDominators() {
+  std::size_t n = blocks.size();
+  reachable.assign(n, false);
+  std::vector<std::size_t> pending;
+  if (n > 0) {
+    reachable[0] = true;
+    pending.push_back(0);
+  }
+  while (not pending.empty()) {
+    std::size_t b = pending.back();
+    pending.pop_back();
+    for (auto s : blocks[b].succs)
+      if (not reachable[s]) {
+        reachable[s] = true;
+        pending.push_back(s);
+      }
+  }
+
+  // iterative data flow: dom(b) = {b} + intersection of dom(p), p pred of b
+  dom.assign(n, std::vector<bool>(n, true));
+  if (n > 0) {
+    dom[0].assign(n, false);
+    dom[0][0] = true;
+  }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (std::size_t b = 1; b < n; ++b) {
+      if (not reachable[b]) continue;
+      std::vector<bool> d(n, true);
+      for (auto p : blocks[b].preds)
+        if (reachable[p])
+          for (std::size_t a = 0; a < n; ++a)
+            d[a] = d[a] and dom[p][a];
+      d[b] = true;
+      if (d != dom[b]) {
+        dom[b] = d;
+        changed = true;
+      }
+    }
+  }
+}
+
+// ----------------------------------------------------------------------
+// accessors
+
+std::size_t CFG::getNumBlocks() const {
+  return blocks.size();
+}
+
+const CFG::BasicBlock & CFG::getBlock(std::size_t b) const {
+  return blocks[b];
+}
+
+std::size_t CFG::getBlockOf(std::size_t pos) const {
+  return blockOf[pos];
+}
+
+std::size_t CFG::getLabelBlock(const std::string & label) const {
+  return labelBlock.at(label);
+}
+
+bool CFG::dominates(std::size_t a, std::size_t b) const {
+  return reachable[b] and dom[b][a];
+}
+
+// ----------------------------------------------------------------------
+// loops
+
+std::vector<CFG::Loop> CFG::getLoops() const {
+  // back edges latch -> header, grouped by header
+  std::map<std::size_t, Loop> byHeader;
+  for (std::size_t b = 0; b < blocks.size(); ++b)
+    for (auto h : blocks[b].succs)
+      if (dominates(h, b)) {
+        Loop & loop = byHeader[h];
+        loop.header = h;
+        loop.latches.push_back(b);
+      }
+
+  std::vector<Loop> loops;
+  for (auto & hl : byHeader) {
+    Loop loop = hl.second;
+    loop.blocks.insert(loop.header);
+    std::vector<std::size_t> pending(loop.latches);
+    while (not pending.empty()) {
+      std::size_t b = pending.back();
+      pending.pop_back();
+      if (loop.blocks.count(b)) continue;
+      loop.blocks.insert(b);
+      for (auto p : blocks[b].preds)
+        if (reachable[p]) pending.push_back(p);
+    }
+    loops.push_back(loop);
+  }
+  std::sort(loops.begin(), loops.end(),
+            [](const Loop & l1, const Loop & l2) { return l1.blocks.size() < l2.blocks.size(); });
+  return loops;
+}
@@ -0,0 +1,87 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    CFG - Control flow graph (basic blocks) of the instruction
+//          list of a subroutine
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Class CFG: splits an instruction list into basic blocks and links
+// them with their successors/predecessors. A block starts at the
+// first instruction, at each label and after each goto, ifFalse and
+// return. Calls do not end a block (they always return to the next
+// instruction). Blocks are numbered in the order they appear in the
+// list, so block 0 is the entry of the subroutine.
+//
+// Dominators and natural loops are also computed, for the loop
+// optimizations.
+//
+// The CFG keeps positions in the list, so it has to be rebuilt when
+// instructions are inserted or removed.
+
+class CFG {
+
+public:
+
+  struct BasicBlock {
+    // positions of its instructions in the list: [first, last)
+    std::size_t first, last;
+    // successor and predecessor blocks
+    std::vector<std::size_t> succs, preds;
+  };
+
+  // A natural loop: the header and all the blocks that can reach one
+  // of the latches (blocks with a back edge to the header) without
+  // going through the header
+  struct Loop {
+    std::size_t              header;
+    std::vector<std::size_t> latches;
+    std::set<std::size_t>    blocks;
+  };
+
+  // Constructor
+  CFG(const instructionList & lins);
+
+  // Accessors to the blocks
+  std::size_t        getNumBlocks ()                  const;
+  const BasicBlock & getBlock     (std::size_t b)     const;
+  // Block containing the instruction at position pos
+  std::size_t        getBlockOf   (std::size_t pos)   const;
+  // Block starting with the given label
+  std::size_t        getLabelBlock(const std::string & label) const;
+
+  // Whether block a dominates block b (every path from the entry to b
+  // goes through a). Unreachable blocks are not dominated by any block
+  bool dominates(std::size_t a, std::size_t b) const;
+  // Natural loops, inner (smaller) loops first
+  std::vector<Loop> getLoops() const;
+
+private:
+
+  std::vector<BasicBlock> blocks;
+  // position of an instruction -> its block
+  std::vector<std::size_t> blockOf;
+  // label -> block it starts
+  std::map<std::string, std::size_t> labelBlock;
+  // dom[b][a] is true if a dominates b
+  std::vector<std::vector<bool>> dom;
+  // blocks that can be reached from the entry
+  std::vector<bool> reachable;
+
+  void addEdge(std::size_t from, std::size_t to);
+  void computeDominators();
+
+};  // class CFG
@@ -0,0 +1,399 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    CTranslator - Translation of the t-code to a C program, to be
+//                  compiled to a native executable
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "CTranslator.h"
+
+#include <vector>
+
+// using namespace std;
+
+
+// ======================================================================
+// Auxiliary functions
+
+namespace {
+
+// what every translated program starts with: the words, the
+// parameter stack and the input and error functions. The integers
+// are 32-bit ints, as in the tvm. The input is read in blocks of
+// 64 KB and the numbers are parsed by hand, which is much faster than
+// scanf for programs that read many numbers
+const char * const Prelude =
+  "/* C translation of the t-code of an ASL program (asl --emit=c) */\n"
+  "\n"
+  "#include <ctype.h>\n"
+  "#include <stdio.h>\n"
+  "#include <stdlib.h>\n"
+  "#include <string.h>\n"
+  "\n"
+  "typedef union word {\n"
+  "  int i;\n"
+  "  double f;\n"
+  "  union word * a;\n"
+  "} word;\n"
+  "\n"
+  "static inline word I(int i) { word w; w.i = i; return w; }\n"
+  "static inline word F(double f) { word w; w.f = f; return w; }\n"
+  "\n"
+  "#define STACK_SIZE (1 << 20)\n"
+  "static word stack[STACK_SIZE];\n"
+  "static word * sp = stack;\n"
+  "\n"
+  "/* the input is read in blocks, and the numbers are parsed here */\n"
+  "static unsigned char input[1 << 16];\n"
+  "static size_t inputPos = 0, inputLen = 0;\n"
+  "\n"
+  "static inline int readc(void) {\n"
+  "  if (inputPos == inputLen) {\n"
+  "    inputLen = fread(input, 1, sizeof input, stdin);\n"
+  "    inputPos = 0;\n"
+  "    if (inputLen == 0) return EOF;\n"
+  "  }\n"
+  "  return input[inputPos++];\n"
+  "}\n"
+  "/* give back the last character read */\n"
+  "static inline void unreadc(int c) {\n"
+  "  if (c != EOF) --inputPos;\n"
+  "}\n"
+  "static inline int skipSpaces(void) {\n"
+  "  int c;\n"
+  "  do c = readc(); while (isspace(c));\n"
+  "  return c;\n"
+  "}\n"
+  "static inline int readi(void) {\n"
+  "  int c = skipSpaces(), minus = 0;\n"
+  "  unsigned i = 0;\n"
+  "  if (c == '-' || c == '+') {\n"
+  "    minus = (c == '-');\n"
+  "    c = readc();\n"
+  "  }\n"
+  "  for (; isdigit(c); c = readc())\n"
+  "    i = 10u * i + (unsigned) (c - '0');\n"
+  "  unreadc(c);\n"
+  "  return (int) (minus ? 0u - i : i);\n"
+  "}\n"
+  "static inline double readf(void) {\n"
+  "  char number[64];\n"
+  "  size_t n = 0;\n"
+  "  int c = skipSpaces();\n"
+  "  for (; n+1 < sizeof number && (isdigit(c) || (c > 0 && strchr(\"+-.eE\", c))); c = readc())\n"
+  "    number[n++] = (char) c;\n"
+  "  unreadc(c);\n"
+  "  number[n] = 0;\n"
+  "  return strtod(number, NULL);\n"
+  "}\n"
+  "static inline void outOfRange(void) {\n"
+  "  fflush(stdout);\n"
+  "  fprintf(stderr, \"index out of range\\n\");\n"
+  "  exit(EXIT_FAILURE);\n"
+  "}\n";
+
+// string as a C literal
+std::string quoted(const std::string & s) {
+  std::string q = "\"";
+  for (char c : s) {
+    if (c == '\n')      q += "\\n";
+    else if (c == '\t') q += "\\t";
+    else if (c == '"')  q += "\\\"";
+    else if (c == '\\') q += "\\\\";
+    else                q += c;
+  }
+  return q + "\"";
+}
+
+// character of a chload ("a", "\n", ...) as a C literal
+std::string charLiteral(const std::string & c) {
+  if (c == "'")  return "'\\''";
+  return "'" + c + "'";
+}
+
+// a1 = a2 op a3, with the operands and the result of the given types
+// ("i" or "f")
+std::string binary(const std::string & a1, const std::string & result,
+                   const std::string & a2, const std::string & op,
+                   const std::string & a3) {
+  return a1 + "." + result + " = " + a2 + " " + op + " " + a3 + ";";
+}
+
+// a1 = a2 op a3 on integers that wrap around at 32 bits, as in the
+// tvm (the operation is done on unsigned ints, where it is defined)
+std::string wrapping(const std::string & a1, const std::string & a2,
+                     const std::string & op, const std::string & a3) {
+  return a1 + ".i = (int) ((unsigned) " + a2 + " " + op + " (unsigned) " + a3 + ");";
+}
+
+}  // namespace
+
+
+// ======================================================================
+// class CTranslator
+
+// ----------------------------------------------------------------------
+// constructor
+
+CTranslator::CTranslator() {
+}
+
+// ----------------------------------------------------------------------
+// translation
+
+std::string CTranslator::translate(const code & c) const {
+  std::string prog = Prelude;
+  const std::vector<std::string> & strings = c.get_strings();
+  if (not strings.empty()) {
+    prog += "\nstatic const char * const strings[] = {\n";
+    for (auto & s : strings)
+      prog += "  " + quoted(s) + ",\n";
+    prog += "};\n";
+  }
+  prog += "\n";
+  for (auto & subr : c.get_subroutines())
+    prog += "static void " + function(subr.get_name()) + "(word * P);\n";
+  for (auto & subr : c.get_subroutines())
+    prog += "\n" + translate(subr, c);
+  prog += "\nint main(void) {\n"
+          "  " + function("main") + "(sp);\n"
+          "  return EXIT_SUCCESS;\n"
+          "}\n";
+  return prog;
+}
+
+std::string CTranslator::translate(const subroutine & subr, const code & c) const {
+  Frame fr;
+  for (auto & p : subr.params) {
+    std::size_t k = fr.params.size();
+    fr.params[p.name] = k;
+  }
+  std::string f = "static void " + function(subr.get_name()) + "(word * P) {\n";
+  if (subr.params.empty())
+    f += "  (void) P;\n";
+  for (auto & v : subr.vars)
+    if (v.size > 1) {
+      fr.arrays.insert(v.name);
+      f += "  word " + word(v.name, fr) + "[" + std::to_string(v.size) + "] = {{0}};\n";
+    }
+    else
+      f += "  word " + word(v.name, fr) + " = {0};\n";
+  // the temporals, in order of appearance
+  std::set<std::string> temps;
+  for (auto & inst : subr.get_instructions())
+    for (auto arg : {inst.arg1, inst.arg2, inst.arg3})
+      if (instruction::isTemp(arg) and temps.insert(arg).second)
+        f += "  word " + word(arg, fr) + " = {0};\n";
+  findCallFrames(subr, c, fr);
+  for (auto & cf : fr.callFrames)
+    f += "  word " + cf.second.first + "[" + std::to_string(cf.second.second) + "];\n";
+  const instructionList & lins = subr.get_instructions();
+  for (std::size_t i = 0; i < lins.size(); ++i)
+    f += (lins[i].oper == instruction::_LABEL ? "" : "  ") + translate(lins[i], i, fr, c) + "\n";
+  return f + "}\n";
+}
+
+void CTranslator::findCallFrames(const subroutine & subr, const code & c, Frame & fr) {
+  const instructionList & lins = subr.get_instructions();
+  for (std::size_t i = 0; i < lins.size(); ++i) {
+    if (lins[i].oper != instruction::_CALL) continue;
+    std::size_t n = c.get_subroutine(lins[i].arg1).params.size();
+
+    // its pushparams, skipping the ones of the calls made while
+    // computing the arguments, and then its popparams
+    std::vector<std::size_t> pushes;
+    std::size_t depth = 0;
+    bool ok = true;
+    for (std::size_t j = i; j > 0 and ok and pushes.size() < n; --j) {
+      const instruction & inst = lins[j-1];
+      if (inst.oper == instruction::_LABEL or inst.isJump()) ok = false;
+      else if (inst.oper == instruction::_POP) ++depth;
+      else if (inst.oper == instruction::_PUSH) {
+        if (depth == 0) pushes.push_back(j-1);
+        else --depth;
+      }
+    }
+    ok = ok and pushes.size() == n and i+n < lins.size();
+    for (std::size_t k = 1; k <= n and ok; ++k)
+      ok = lins[i+k].oper == instruction::_POP;
+    // (a call without parameters needs no frame: zero-length arrays
+    // are not C)
+    if (not ok or n == 0) continue;
+
+    std::string name = "a" + std::to_string(i);
+    fr.callFrames[i] = std::make_pair(name, n);
+    for (std::size_t k = 0; k < n; ++k) {
+      fr.slots[pushes[k]] = std::make_pair(name, n-1-k);
+      fr.slots[i+1+k]     = std::make_pair(name, n-1-k);
+    }
+  }
+}
+
+std::string CTranslator::translate(const instruction & inst, std::size_t pos,
+                                   const Frame & fr, const code & c) const {
+  const std::string & a1 = inst.arg1, & a2 = inst.arg2, & a3 = inst.arg3;
+  std::string w1 = a1.empty() ? "" : word(a1, fr);
+  // parameters of a call with its own frame
+  auto slot = fr.slots.find(pos);
+  if (slot != fr.slots.end()) {
+    std::string w = slot->second.first + "[" + std::to_string(slot->second.second) + "]";
+    if (a1.empty()) return ";";
+    return inst.oper == instruction::_PUSH ? w + " = " + value(a1, fr) + ";" : w1 + " = " + w + ";";
+  }
+  auto frame = fr.callFrames.find(pos);
+  if (frame != fr.callFrames.end())
+    return function(a1) + "(" + frame->second.first + ");";
+  switch (inst.oper) {
+  case instruction::_LABEL :   return label(a1) + ": ;";
+  case instruction::_UJUMP :   return "goto " + label(a1) + ";";
+  case instruction::_FJUMP :   return "if (!" + integer(a1, fr) + ") goto " + label(a2) + ";";
+  case instruction::_PUSH :
+    return a1.empty() ? "++sp;" : "*sp++ = " + value(a1, fr) + ";";
+  case instruction::_POP :
+    return a1.empty() ? "--sp;" : w1 + " = *--sp;";
+  case instruction::_CALL : {
+    std::size_t n = c.get_subroutine(a1).params.size();
+    if (n == 0) return function(a1) + "(sp);";
+    return function(a1) + "(sp - " + std::to_string(n) + ");";
+  }
+  case instruction::_TAILCALL : {
+    // the arguments are on the stack: the space for the result goes
+    // below them, and the result is the one of this function
+    const subroutine & callee = c.get_subroutine(a1);
+    std::size_t n = callee.params.size();
+    if (not callee.isFunction())
+      return function(a1) + "(sp - " + std::to_string(n) + "); sp -= " +
+             std::to_string(n) + "; return;";
+    std::string args = std::to_string(n-1), frame = std::to_string(n);
+    return "memmove(sp - " + args + " + 1, sp - " + args + ", " + args +
+           " * sizeof(word)); ++sp; " + function(a1) + "(sp - " + frame + "); " +
+           word("_result", fr) + " = sp[-" + frame + "]; sp -= " + frame + "; return;";
+  }
+  case instruction::_RETURN :  return "return;";
+  case instruction::_NOOP :    return ";";
+
+  case instruction::_ADD :   return wrapping(w1, integer(a2, fr), "+", integer(a3, fr));
+  case instruction::_SUB :   return wrapping(w1, integer(a2, fr), "-", integer(a3, fr));
+  case instruction::_MUL :   return wrapping(w1, integer(a2, fr), "*", integer(a3, fr));
+  case instruction::_DIV :   return binary(w1, "i", integer(a2, fr), "/",  integer(a3, fr));
+  case instruction::_MOD :   return binary(w1, "i", integer(a2, fr), "%",  integer(a3, fr));
+  case instruction::_EQ :    return binary(w1, "i", integer(a2, fr), "==", integer(a3, fr));
+  case instruction::_NE :    return binary(w1, "i", integer(a2, fr), "!=", integer(a3, fr));
+  case instruction::_LT :    return binary(w1, "i", integer(a2, fr), "<",  integer(a3, fr));
+  case instruction::_LE :    return binary(w1, "i", integer(a2, fr), "<=", integer(a3, fr));
+  case instruction::_GT :    return binary(w1, "i", integer(a2, fr), ">",  integer(a3, fr));
+  case instruction::_GE :    return binary(w1, "i", integer(a2, fr), ">=", integer(a3, fr));
+  case instruction::_AND :   return binary(w1, "i", integer(a2, fr), "&&", integer(a3, fr));
+  case instruction::_OR :    return binary(w1, "i", integer(a2, fr), "||", integer(a3, fr));
+  case instruction::_NEG :   return wrapping(w1, "0", "-", integer(a2, fr));
+  case instruction::_NOT :   return w1 + ".i = !" + integer(a2, fr) + ";";
+  case instruction::_FLOAT : return w1 + ".f = " + integer(a2, fr) + ";";
+
+  case instruction::_FADD :  return binary(w1, "f", real(a2, fr), "+",  real(a3, fr));
+  case instruction::_FSUB :  return binary(w1, "f", real(a2, fr), "-",  real(a3, fr));
+  case instruction::_FMUL :  return binary(w1, "f", real(a2, fr), "*",  real(a3, fr));
+  case instruction::_FDIV :  return binary(w1, "f", real(a2, fr), "/",  real(a3, fr));
+  case instruction::_FEQ :   return binary(w1, "i", real(a2, fr), "==", real(a3, fr));
+  case instruction::_FLT :   return binary(w1, "i", real(a2, fr), "<",  real(a3, fr));
+  case instruction::_FLE :   return binary(w1, "i", real(a2, fr), "<=", real(a3, fr));
+  // the negations of ==., <=. and <. (true if an operand is not a number)
+  case instruction::_FNE :
+    return w1 + ".i = !(" + real(a2, fr) + " == " + real(a3, fr) + ");";
+  case instruction::_FGT :
+    return w1 + ".i = !(" + real(a2, fr) + " <= " + real(a3, fr) + ");";
+  case instruction::_FGE :
+    return w1 + ".i = !(" + real(a2, fr) + " < " + real(a3, fr) + ");";
+  case instruction::_FNEG :  return w1 + ".f = - " + real(a2, fr) + ";";
+
+  case instruction::_LOAD :
+    // the assignment of arrays is done element by element before
+    // (or by a memcpy), and then the arrays are "assigned" as if
+    // they were words: that has no effect
+    if (fr.arrays.count(a1) or fr.arrays.count(a2)) return ";";
+    return w1 + " = " + value(a2, fr) + ";";
+  case instruction::_ILOAD :   return w1 + ".i = " + a2 + ";";
+  case instruction::_FLOAD :   return w1 + ".f = " + a2 + ";";
+  case instruction::_CHLOAD :  return w1 + ".i = " + charLiteral(a2) + ";";
+  case instruction::_XLOAD :
+    return address(a1, fr) + "[" + integer(a2, fr) + "] = " + value(a3, fr) + ";";
+  case instruction::_LOADX :
+    return w1 + " = " + address(a2, fr) + "[" + integer(a3, fr) + "];";
+  case instruction::_ALOAD :
+    return w1 + ".a = " + (fr.arrays.count(a2) ? "" : "&") + word(a2, fr) + ";";
+  case instruction::_LOADC :   return w1 + " = *" + word(a2, fr) + ".a;";
+  case instruction::_CLOAD :   return "*" + w1 + ".a = " + value(a2, fr) + ";";
+  case instruction::_MEMCPY :
+    return "memcpy(" + address(a1, fr) + ", " + address(a2, fr) + ", " + a3 +
+           " * sizeof(word));";
+
+  case instruction::_IFEQ :  return "if (" + integer(a1, fr) + " == " + integer(a2, fr) + ") goto " + label(a3) + ";";
+  case instruction::_IFNE :  return "if (" + integer(a1, fr) + " != " + integer(a2, fr) + ") goto " + label(a3) + ";";
+  case instruction::_IFLT :  return "if (" + integer(a1, fr) + " < "  + integer(a2, fr) + ") goto " + label(a3) + ";";
+  case instruction::_IFLE :  return "if (" + integer(a1, fr) + " <= " + integer(a2, fr) + ") goto " + label(a3) + ";";
+  case instruction::_IFGT :  return "if (" + integer(a1, fr) + " > "  + integer(a2, fr) + ") goto " + label(a3) + ";";
+  case instruction::_IFGE :  return "if (" + integer(a1, fr) + " >= " + integer(a2, fr) + ") goto " + label(a3) + ";";
+  case instruction::_IFFEQ : return "if (" + real(a1, fr) + " == " + real(a2, fr) + ") goto " + label(a3) + ";";
+  case instruction::_IFFNE : return "if (!(" + real(a1, fr) + " == " + real(a2, fr) + ")) goto " + label(a3) + ";";
+  case instruction::_IFFLT : return "if (" + real(a1, fr) + " < "  + real(a2, fr) + ") goto " + label(a3) + ";";
+  case instruction::_IFFLE : return "if (" + real(a1, fr) + " <= " + real(a2, fr) + ") goto " + label(a3) + ";";
+  case instruction::_IFFGT : return "if (!(" + real(a1, fr) + " <= " + real(a2, fr) + ")) goto " + label(a3) + ";";
+  case instruction::_IFFGE : return "if (!(" + real(a1, fr) + " < "  + real(a2, fr) + ")) goto " + label(a3) + ";";
+
+  case instruction::_CHECK :
+    return "if (" + integer(a1, fr) + " < 0 || " + integer(a1, fr) + " >= " + a2 +
+           ") outOfRange();";
+
+  case instruction::_READI :   return w1 + ".i = readi();";
+  case instruction::_READF :   return w1 + ".f = readf();";
+  case instruction::_READC :   return w1 + ".i = skipSpaces();";
+  case instruction::_WRITEI :  return "printf(\"%d\", " + integer(a1, fr) + ");";
+  case instruction::_WRITEF :  return "printf(\"%g\", " + real(a1, fr) + ");";
+  case instruction::_WRITEC :  return "putchar((int) " + integer(a1, fr) + ");";
+  case instruction::_WRITELN : return "putchar('\\n');";
+  case instruction::_WRITES :  return "fputs(strings[" + a1.substr(1) + "], stdout);";
+
+  default : return "/* " + inst.dump() + " */";
+  }
+}
+
+// ----------------------------------------------------------------------
+// names and operands
+
+std::string CTranslator::function(const std::string & name) {
+  return "f_" + name;
+}
+
+std::string CTranslator::label(const std::string & name) {
+  return "l_" + name;
+}
+
+std::string CTranslator::word(const std::string & name, const Frame & fr) {
+  if (instruction::isTemp(name)) return "t" + name.substr(1);
+  auto p = fr.params.find(name);
+  if (p != fr.params.end()) return "P[" + std::to_string(p->second) + "]";
+  return "v_" + name;
+}
+
+std::string CTranslator::value(const std::string & arg, const Frame & fr) {
+  switch (instruction::operandKind(arg)) {
+  case instruction::_INTIMM :
+  case instruction::_CHARIMM :  return "I(" + arg + ")";
+  case instruction::_FLOATIMM : return "F(" + arg + ")";
+  default :                     return word(arg, fr);
+  }
+}
+
+std::string CTranslator::integer(const std::string & arg, const Frame & fr) {
+  if (instruction::isImmediate(arg)) return arg;
+  return word(arg, fr) + ".i";
+}
+
+std::string CTranslator::real(const std::string & arg, const Frame & fr) {
+  if (instruction::isImmediate(arg)) return arg;
+  return word(arg, fr) + ".f";
+}
+
+std::string CTranslator::address(const std::string & name, const Frame & fr) {
+  if (fr.arrays.count(name)) return word(name, fr);
+  return word(name, fr) + ".a";
+}
@@ -0,0 +1,97 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    CTranslator - Translation of the t-code to a C program, to be
+//                  compiled to a native executable
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>    // std::pair
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Class CTranslator: writes a C program that does what the t-code
+// does in the tvm (asl --emit=c). The result only uses the standard
+// library, and can be compiled with any C99 compiler (cc -O2).
+//
+// Every value is a word, as in the tvm: a union of an integer (ints,
+// chars and bools: a 32-bit int, whose operations wrap around as in
+// the tvm), a float and an address. Each subroutine becomes
+// a C function:
+//   - its local variables and temporals are C variables (arrays for
+//     the local arrays), initialized to 0 in each call,
+//   - its parameters are the words of the parameter stack that the
+//     caller has pushed: pushparam/popparam push and pop words of a
+//     global stack, and 'call f' is a direct call to f with a
+//     pointer to its parameters there. When the pushparams and
+//     popparams of a call are in its block (as generated for the
+//     calls in expressions and statements), they are written and read
+//     directly in an array of the caller instead, which is the frame
+//     of parameters of the call,
+//   - labels and jumps are C labels and gotos, and the type of each
+//     operation (integer or float) is the one of its instruction,
+//   - the output instructions use the buffered stdio, and the input
+//     ones read the input in blocks and parse the numbers by hand
+//     (skipping the white space before them, also for readc).
+// Both the stock and the extended instruction sets are translated.
+
+class CTranslator {
+
+public:
+
+  // Constructor
+  CTranslator();
+
+  // C program equivalent to the t-code
+  std::string translate(const code & c) const;
+
+private:
+
+  // Names of the subroutine being translated
+  struct Frame {
+    // parameter name -> position in the parameters
+    std::map<std::string, std::size_t> params;
+    // local arrays
+    std::set<std::string> arrays;
+    // calls whose parameters are pushed and popped around them in the
+    // same block: position of the call -> name and size of the array
+    // of words that holds their parameters (in the frame of the
+    // caller, instead of in the stack)
+    std::map<std::size_t, std::pair<std::string, std::size_t>> callFrames;
+    // position of each pushparam and popparam of these calls -> array
+    // and position of the parameter there
+    std::map<std::size_t, std::pair<std::string, std::size_t>> slots;
+  };
+
+  // C function for a subroutine
+  std::string translate(const subroutine & subr, const code & c) const;
+  // find the calls that can have their parameters in the frame of
+  // the caller
+  static void findCallFrames(const subroutine & subr, const code & c, Frame & fr);
+  // C statement for the instruction at position pos
+  std::string translate(const instruction & inst, std::size_t pos,
+                        const Frame & fr, const code & c) const;
+
+  // C names of a subroutine, a label and a variable, parameter or
+  // temporal (a word)
+  static std::string function(const std::string & name);
+  static std::string label(const std::string & name);
+  static std::string word(const std::string & name, const Frame & fr);
+  // an operand as a word, an integer or a float
+  static std::string value(const std::string & arg, const Frame & fr);
+  static std::string integer(const std::string & arg, const Frame & fr);
+  static std::string real(const std::string & arg, const Frame & fr);
+  // address of the first element of an array (a local array, or a
+  // word holding its address)
+  static std::string address(const std::string & name, const Frame & fr);
+
+};  // class CTranslator
@@ -0,0 +1,105 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    CallResolver - Check that every call of the generated program
+//                   reaches one of its subroutines, and call graph
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "CallResolver.h"
+
+#include <algorithm>  // std::find
+
+// using namespace std;
+
+
+// ======================================================================
+// class CallResolver
+
+// ----------------------------------------------------------------------
+// constructor
+
+CallResolver::CallResolver() : calls(0) {
+}
+
+// ----------------------------------------------------------------------
+// resolution of the calls
+
+bool CallResolver::resolve(const code & c) {
+  names.clear();
+  indexes.clear();
+  graph.clear();
+  calls = 0;
+  unresolved.clear();
+  unused.clear();
+
+  for (auto & subr : c.get_subroutines()) {
+    indexes[subr.get_name()] = names.size();
+    names.push_back(subr.get_name());
+  }
+  graph.resize(names.size());
+  std::vector<bool> called(names.size(), false);
+  for (std::size_t i = 0; i < names.size(); ++i)
+    for (auto & inst : c.get_subroutines()[i].get_instructions()) {
+      if (inst.oper != instruction::_CALL and inst.oper != instruction::_TAILCALL)
+        continue;
+      auto callee = indexes.find(inst.arg1);
+      if (callee == indexes.end()) {
+        unresolved.push_back(names[i] + " -> " + inst.arg1);
+        continue;
+      }
+      ++calls;
+      called[callee->second] = true;
+      std::vector<std::size_t> & out = graph[i];
+      if (std::find(out.begin(), out.end(), callee->second) == out.end())
+        out.push_back(callee->second);
+    }
+  for (std::size_t i = 0; i < names.size(); ++i)
+    if (not called[i] and names[i] != "main")
+      unused.push_back(names[i]);
+  return unresolved.empty();
+}
+
+// ----------------------------------------------------------------------
+// subroutine table and call graph
+
+std::size_t CallResolver::size() const {
+  return names.size();
+}
+
+const std::string & CallResolver::name(std::size_t index) const {
+  return names[index];
+}
+
+std::size_t CallResolver::index(const std::string & name) const {
+  auto it = indexes.find(name);
+  return it == indexes.end() ? names.size() : it->second;
+}
+
+const std::vector<std::size_t> & CallResolver::callees(std::size_t index) const {
+  return graph[index];
+}
+
+// ----------------------------------------------------------------------
+// statistics
+
+std::string CallResolver::dumpStats() const {
+  std::string s = "calls: subroutines          " + std::to_string(names.size()) + "\n" +
+                  "calls: resolved             " + std::to_string(calls) + "\n" +
+                  "calls: unresolved           " + std::to_string(unresolved.size()) + "\n" +
+                  "calls: unused subroutines   " + std::to_string(unused.size()) + "\n";
+  for (auto & u : unresolved)
+    s += "calls: unresolved " + u + "\n";
+  for (auto & u : unused)
+    s += "calls: unused " + u + "\n";
+  return s;
+}
+
+std::string CallResolver::dumpCallGraph() const {
+  std::string s = "digraph calls {\n";
+  for (auto & n : names)
+    s += "  \"" + n + "\";\n";
+  for (std::size_t i = 0; i < names.size(); ++i)
+    for (auto j : graph[i])
+      s += "  \"" + names[i] + "\" -> \"" + names[j] + "\";\n";
+  return s + "}\n";
+}
@@ -0,0 +1,74 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    CallResolver - Check that every call of the generated program
+//                   reaches one of its subroutines, and call graph
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Class CallResolver: numbers the subroutines of a program with dense
+// indexes (their order in the program, main included) and finds the
+// callee of every call and tailcall, which gives a table of
+// subroutines and a call graph over it (see DeadFunctions). Calls to
+// subroutines that do not exist are reported (they are errors of the
+// code generator or of an optimization), and so are the subroutines
+// that are never called.
+//
+// It is a check, not a link step: the code is not changed, and the
+// calls keep naming the subroutines, since that is what the tvm
+// understands.
+
+class CallResolver {
+
+public:
+
+  // Constructor
+  CallResolver();
+
+  // Resolve the calls of the program. Returns false if some call does
+  // not reach a subroutine
+  bool resolve(const code & c);
+
+  // Number of subroutines, and name and index of each one (index
+  // returns the number of subroutines if there is none with that name)
+  std::size_t size() const;
+  const std::string & name(std::size_t index) const;
+  std::size_t index(const std::string & name) const;
+  // Subroutines called by a subroutine (indexes, in the order of the
+  // calls, each one once)
+  const std::vector<std::size_t> & callees(std::size_t index) const;
+
+  // What has been found: counters, plus the unresolved calls and the
+  // unused subroutines
+  std::string dumpStats() const;
+  // The call graph, in the dot format of Graphviz (calls and tailcalls
+  // are edges, each one once)
+  std::string dumpCallGraph() const;
+
+private:
+
+  // subroutines in order
+  std::vector<std::string> names;
+  // name -> index
+  std::map<std::string, std::size_t> indexes;
+  // call graph
+  std::vector<std::vector<std::size_t>> graph;
+  // calls resolved
+  std::size_t calls;
+  // unresolved calls ("f -> g") and unused subroutines
+  std::vector<std::string> unresolved;
+  std::vector<std::string> unused;
+
+};  // class CallResolver
@@ -0,0 +1,62 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    DeadFunctions - Removal of the subroutines that can not be
+//                    reached from main
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "DeadFunctions.h"
+#include "CallResolver.h"
+
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+// ======================================================================
+// class DeadFunctions
+
+// ----------------------------------------------------------------------
+// constructor
+
+DeadFunctions::DeadFunctions() {
+}
+
+// ----------------------------------------------------------------------
+// optimization
+
+void DeadFunctions::optimize(code & c) {
+  CallResolver calls;
+  calls.resolve(c);
+  std::size_t root = calls.index("main");
+  if (root == calls.size()) return;
+
+  // depth-first traversal of the call graph from main
+  std::vector<bool> reached(calls.size(), false);
+  std::vector<std::size_t> pending(1, root);
+  reached[root] = true;
+  while (not pending.empty()) {
+    std::size_t s = pending.back();
+    pending.pop_back();
+    for (auto callee : calls.callees(s))
+      if (not reached[callee]) {
+        reached[callee] = true;
+        pending.push_back(callee);
+      }
+  }
+  for (std::size_t s = 0; s < calls.size(); ++s)
+    if (not reached[s]) {
+      removed.push_back(calls.name(s));
+      c.remove_subroutine(calls.name(s));
+    }
+}
+
+// ----------------------------------------------------------------------
+// statistics
+
+std::string DeadFunctions::dumpStats() const {
+  std::string s = "deadfunc: removed           " + std::to_string(removed.size()) + "\n";
+  for (auto & name : removed)
+    s += "deadfunc: removed " + name + "\n";
+  return s;
+}
@@ -0,0 +1,43 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    DeadFunctions - Removal of the subroutines that can not be
+//                    reached from main
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <string>
+#include <vector>
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Class DeadFunctions: removes from the program the subroutines that
+// are not reachable from main in the call graph (given by the calls
+// and tailcalls, see CallResolver): functions that are never called, only
+// called from other unreachable ones, or whose calls have all been
+// inlined. Programs without main are left as they are.
+
+class DeadFunctions {
+
+public:
+
+  // Constructor
+  DeadFunctions();
+
+  // Remove the unreachable subroutines of the program
+  void optimize(code & c);
+
+  // What has been done: counter plus one line per subroutine removed
+  std::string dumpStats() const;
+
+private:
+
+  // subroutines removed, in the order of the program
+  std::vector<std::string> removed;
+
+};  // class DeadFunctions
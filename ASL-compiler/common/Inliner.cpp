@@ -0,0 +1,323 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    Inliner - Replaces calls to small (or called only once)
+//              subroutines by a copy of their code
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "Inliner.h"
+
+#include <algorithm>  // std::find, std::max, std::reverse
+#include <functional> // std::function
+
+// using namespace std;
+
+
+// ======================================================================
+// Auxiliary functions
+
+namespace {
+
+// size of a subroutine, as counted by the heuristic (labels and the
+// final return do not generate work)
+std::size_t size(const subroutine & subr) {
+  std::size_t n = 0;
+  for (auto & inst : subr.get_instructions())
+    if (inst.oper != instruction::_LABEL) ++n;
+  return n > 0 ? n-1 : 0;
+}
+
+// whether the subroutine takes the address of a parameter (&a, with
+// a an array parameter): it gives the address of the parameter in
+// the stack, which would change once inlined
+bool takesParamAddress(const subroutine & subr) {
+  for (auto & inst : subr.get_instructions())
+    if (inst.oper == instruction::_ALOAD)
+      for (auto & p : subr.params)
+        if (p.name == inst.arg2) return true;
+  return false;
+}
+
+// whether the subroutine has local arrays: they start as 0 on each
+// call, and they are not reset in the inlined copy
+bool hasLocalArrays(const subroutine & subr) {
+  for (auto & v : subr.vars)
+    if (v.size > 1) return true;
+  return false;
+}
+
+// whether the subroutine has a tailcall: once inlined, it would leave
+// the caller
+bool hasTailCall(const subroutine & subr) {
+  for (auto & inst : subr.get_instructions())
+    if (inst.oper == instruction::_TAILCALL) return true;
+  return false;
+}
+
+}  // namespace
+
+
+// ======================================================================
+// class Inliner
+
+// ----------------------------------------------------------------------
+// constructor
+
+Inliner::Inliner(std::size_t threshold) :
+  threshold(threshold), sites(0), inlined(0) {
+}
+
+// ----------------------------------------------------------------------
+// optimization
+
+void Inliner::optimize(code & c) {
+  if (threshold == 0) return;
+  std::vector<subroutine> & subrs = c.get_subroutines();
+
+  // call graph
+  std::map<std::string, std::size_t> index, calls;
+  std::map<std::string, std::set<std::string>> callees;
+  for (std::size_t i = 0; i < subrs.size(); ++i) {
+    index[subrs[i].get_name()] = i;
+    for (auto & inst : subrs[i].get_instructions())
+      if (inst.oper == instruction::_CALL) {
+        callees[subrs[i].get_name()].insert(inst.arg1);
+        ++calls[inst.arg1];
+      }
+  }
+
+  // subroutines that may call themselves (directly or not)
+  std::set<std::string> recursive;
+  for (auto & subr : subrs) {
+    std::set<std::string> reached;
+    std::vector<std::string> pending(callees[subr.get_name()].begin(),
+                                     callees[subr.get_name()].end());
+    while (not pending.empty()) {
+      std::string f = pending.back();
+      pending.pop_back();
+      if (reached.count(f)) continue;
+      reached.insert(f);
+      for (auto & g : callees[f]) pending.push_back(g);
+    }
+    if (reached.count(subr.get_name())) recursive.insert(subr.get_name());
+  }
+
+  // callees before their callers (postorder of the call graph)
+  std::vector<std::size_t> order;
+  std::set<std::string> visited;
+  std::function<void(const std::string &)> visit = [&](const std::string & f) {
+    if (visited.count(f) or not index.count(f)) return;
+    visited.insert(f);
+    for (auto & g : callees[f]) visit(g);
+    order.push_back(index[f]);
+  };
+  for (auto & subr : subrs) visit(subr.get_name());
+
+  // already processed subroutines, as they have to be copied
+  std::map<std::string, subroutine> done;
+  for (auto i : order) {
+    inlineCalls(subrs[i], done, calls, recursive);
+    done.insert(std::make_pair(subrs[i].get_name(), subrs[i]));
+  }
+}
+
+void Inliner::inlineCalls(subroutine & caller, const std::map<std::string, subroutine> & subs,
+                          const std::map<std::string, std::size_t> & calls,
+                          const std::set<std::string> & recursive) {
+  instructionList lins = caller.get_instructions();
+  std::size_t pos = 0;
+  while (pos < lins.size()) {
+    if (lins[pos].oper != instruction::_CALL) {
+      ++pos;
+      continue;
+    }
+    ++sites;
+    std::string f = lins[pos].arg1;
+    std::string site = "inline: " + caller.get_name() + " -> " + f + ": ";
+    auto it = subs.find(f);
+    if (recursive.count(f)) {
+      decisions.push_back(site + "not inlined (recursive)");
+      ++pos;
+      continue;
+    }
+    if (it == subs.end()) {
+      decisions.push_back(site + "not inlined (unknown subroutine)");
+      ++pos;
+      continue;
+    }
+    if (takesParamAddress(it->second)) {
+      decisions.push_back(site + "not inlined (address of a parameter)");
+      ++pos;
+      continue;
+    }
+    if (hasLocalArrays(it->second)) {
+      decisions.push_back(site + "not inlined (local arrays)");
+      ++pos;
+      continue;
+    }
+    if (hasTailCall(it->second)) {
+      decisions.push_back(site + "not inlined (tail call)");
+      ++pos;
+      continue;
+    }
+    std::size_t sz = size(it->second);
+    std::string why = "size " + std::to_string(sz);
+    if (sz > threshold and calls.at(f) > 1) {
+      decisions.push_back(site + "not inlined (" + why + " > " + std::to_string(threshold) + ")");
+      ++pos;
+      continue;
+    }
+    if (sz > threshold) why += ", only call";
+    std::size_t next = inlineCall(lins, pos, caller, it->second);
+    if (next == 0) {
+      decisions.push_back(site + "not inlined (unexpected call sequence)");
+      ++pos;
+      continue;
+    }
+    decisions.push_back(site + "inlined (" + why + ")");
+    ++inlined;
+    pos = next;
+  }
+  caller.set_instructions(lins);
+}
+
+std::size_t Inliner::inlineCall(instructionList & lins, std::size_t c, subroutine & caller,
+                                const subroutine & callee) {
+  std::size_t n = callee.params.size();
+
+  // pushparams of this call, skipping the ones of the calls made
+  // while computing the arguments
+  std::vector<std::size_t> pushes;
+  std::size_t depth = 0;
+  for (std::size_t i = c; i > 0 and pushes.size() < n; --i) {
+    const instruction & inst = lins[i-1];
+    if (inst.oper == instruction::_LABEL or inst.isJump()) return 0;
+    if (inst.oper == instruction::_POP) ++depth;
+    else if (inst.oper == instruction::_PUSH) {
+      if (depth == 0) pushes.push_back(i-1);
+      else --depth;
+    }
+  }
+  if (pushes.size() != n) return 0;
+  std::reverse(pushes.begin(), pushes.end());
+  for (std::size_t m = 0; m < n; ++m)
+    if (c+1+m >= lins.size() or lins[c+1+m].oper != instruction::_POP) return 0;
+
+  // new names for the variables, temporals and labels of the callee
+  std::string prefix = callee.get_name() + "_" + std::to_string(inlined+1) + "_";
+  std::set<std::string> used;
+  for (auto & v : caller.vars)   used.insert(v.name);
+  for (auto & v : caller.params) used.insert(v.name);
+  std::map<std::string, std::string> rename, relabel;
+  auto newVar = [&](const std::string & name, std::size_t sz) {
+    std::string newName = prefix + name;
+    while (used.count(newName)) newName += "_";
+    used.insert(newName);
+    rename[name] = newName;
+    caller.add_var(newName, sz);
+  };
+  std::vector<std::string> params;
+  for (auto & p : callee.params) {
+    newVar(p.name, 1);
+    params.push_back(rename[p.name]);
+  }
+  for (auto & v : callee.vars)
+    newVar(v.name, v.size);
+  int lastTemp = 0;
+  for (auto & inst : lins) {
+    lastTemp = std::max(lastTemp, instruction::tempNumber(inst.arg1));
+    lastTemp = std::max(lastTemp, instruction::tempNumber(inst.arg2));
+    lastTemp = std::max(lastTemp, instruction::tempNumber(inst.arg3));
+  }
+  const instructionList & body = callee.get_instructions();
+  for (auto & inst : body)
+    if (inst.oper == instruction::_LABEL) relabel[inst.arg1] = prefix + inst.arg1;
+  std::string endLabel = prefix + "end";
+  auto renamed = [&](const std::string & name) {
+    if (instruction::isTemp(name) and not rename.count(name))
+      rename[name] = "%" + std::to_string(++lastTemp);
+    return rename.count(name) ? rename[name] : name;
+  };
+
+  // the copy: arguments, reset of locals, body and results
+  instructionList copy;
+  for (auto & p : callee.params)
+    if (p.name == "_result" and body.mayBeReadUninitialized(p.name))
+      copy.push_back(instruction::ILOAD(rename[p.name], "0"));
+  for (auto & v : callee.vars)
+    if (v.size == 1 and body.mayBeReadUninitialized(v.name))
+      copy.push_back(instruction::ILOAD(rename[v.name], "0"));
+  bool jumpsToEnd = false;
+  for (std::size_t i = 0; i < body.size(); ++i) {
+    instruction inst = body[i];
+    if (inst.oper == instruction::_RETURN) {
+      if (i+1 < body.size()) {
+        copy.push_back(instruction::UJUMP(endLabel));
+        jumpsToEnd = true;
+      }
+      continue;
+    }
+    if (inst.oper == instruction::_LABEL or inst.oper == instruction::_UJUMP)
+      inst.arg1 = relabel[inst.arg1];
+    else if (inst.oper == instruction::_CALL)
+      ;
+    else {
+      std::string target = inst.jumpTarget();
+      // only names are renamed (not literals such as the 'c' in %1 = 'c')
+      std::vector<std::string> names = inst.uses();
+      names.push_back(inst.defines());
+      auto isName = [&](const std::string & arg) {
+        return not arg.empty() and std::find(names.begin(), names.end(), arg) != names.end();
+      };
+      if (isName(inst.arg1)) inst.arg1 = renamed(inst.arg1);
+      if (isName(inst.arg2)) inst.arg2 = renamed(inst.arg2);
+      if (isName(inst.arg3)) inst.arg3 = renamed(inst.arg3);
+      if (inst.isCondJump()) inst.setJumpTarget(relabel[target]);
+      // an array parameter indexed directly (extended instruction set)
+      // is now a local variable of the caller, which can not be
+      // indexed: its address goes through a temporal
+      std::string * base = inst.oper == instruction::_LOADX ? &inst.arg2 :
+                           inst.oper == instruction::_XLOAD ? &inst.arg1 : nullptr;
+      if (base and std::find(params.begin(), params.end(), *base) != params.end()) {
+        std::string temp = "%" + std::to_string(++lastTemp);
+        copy.push_back(instruction::LOAD(temp, *base));
+        *base = temp;
+      }
+    }
+    copy.push_back(inst);
+  }
+  if (jumpsToEnd)
+    copy.push_back(instruction::LABEL(endLabel));
+  // the m-th popparam takes the last parameters first
+  for (std::size_t m = 0; m < n; ++m)
+    if (not lins[c+1+m].arg1.empty())
+      copy.push_back(instruction::LOAD(lins[c+1+m].arg1, params[n-1-m]));
+
+  instructionList newLins;
+  std::size_t k = 0;
+  for (std::size_t i = 0; i < c; ++i) {
+    if (k < n and i == pushes[k]) {
+      if (not lins[i].arg1.empty())
+        newLins.push_back(instruction::LOAD(params[k], lins[i].arg1));
+      ++k;
+    }
+    else
+      newLins.push_back(lins[i]);
+  }
+  newLins = newLins || copy;
+  std::size_t next = newLins.size();
+  newLins.insert(newLins.end(), lins.begin()+c+1+n, lins.end());
+  lins = newLins;
+  return next;
+}
+
+// ----------------------------------------------------------------------
+// statistics
+
+std::string Inliner::dumpStats() const {
+  std::string s = "inline: call sites          " + std::to_string(sites) + "\n" +
+                  "inline: inlined             " + std::to_string(inlined) + "\n";
+  for (auto & d : decisions)
+    s += d + "\n";
+  return s;
+}
@@ -0,0 +1,93 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    Inliner - Replaces calls to small (or called only once)
+//              subroutines by a copy of their code
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Class Inliner: substitutes the call sequence generated by
+// CodeGenVisitor
+//
+//     pushparam              (space for the result, functions only)
+//     pushparam x1 ... pushparam xn
+//     call f
+//     popparam ... popparam  (n times)
+//     popparam t             (result, functions only)
+//
+// by the code of f. The parameters (including _result) and the local
+// variables of f become local variables of the caller, renamed as
+// f_<k>_<name> (k numbers the inlined calls), and the temporals and
+// labels of f are renamed too, so that every inlined copy is
+// independent. Each pushparam becomes a copy to the renamed
+// parameter, each returning popparam a copy from it, and the returns
+// of f become jumps to the end of the copy. Array parameters are
+// passed by reference (the caller pushes the address of the array),
+// so their renamed variable just holds the same address (loaded into a
+// temporal where f indexes the parameter directly). Subroutines
+// taking the address of a parameter (&a) are not inlined, since it is
+// the address of the parameter in the stack.
+//
+// Local variables start as 0 on each call in the VM: the ones that
+// may be read before being written are reset at the beginning of the
+// copy. Subroutines with local arrays are not inlined, since a copy
+// executed again (e.g. in a loop) would see the previous contents.
+//
+// A call is inlined when the callee is not recursive and either its
+// size (instructions, without labels) is not greater than the
+// threshold or it is the only call to it in the program. Subroutines
+// are processed callees first, so the inlined code is the already
+// inlined one. Threshold 0 disables inlining.
+
+class Inliner {
+
+public:
+
+  // Constructor
+  Inliner(std::size_t threshold = 20);
+
+  // Inline the calls of all the subroutines of the program
+  void optimize(code & c);
+
+  // What has been done: counters plus one line per call site with
+  // the inlining decision
+  std::string dumpStats() const;
+
+private:
+
+  // maximum size of the inlined subroutines (if called more than once)
+  std::size_t threshold;
+  // calls found
+  std::size_t sites;
+  // calls inlined
+  std::size_t inlined;
+  // inlining decisions, in the order they were taken
+  std::vector<std::string> decisions;
+
+  // Inline the calls to the subroutines in 'subs' from 'caller'.
+  // 'calls' has the number of calls to each subroutine and
+  // 'recursive' the subroutines that may call themselves
+  void inlineCalls(subroutine & caller, const std::map<std::string, subroutine> & subs,
+                   const std::map<std::string, std::size_t> & calls,
+                   const std::set<std::string> & recursive);
+
+  // Replace the call at position c (with its pushparam/popparam) by
+  // the code of the callee. Returns the position following the
+  // inlined code, or 0 if the call sequence is not the expected one
+  std::size_t inlineCall(instructionList & lins, std::size_t c, subroutine & caller,
+                         const subroutine & callee);
+
+};  // class Inliner
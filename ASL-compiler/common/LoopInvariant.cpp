@@ -0,0 +1,220 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    LoopInvariant - Loop-invariant code motion for t-code
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "LoopInvariant.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+// ======================================================================
+// Auxiliary functions
+
+namespace {
+
+// instructions whose only effect is defining their first argument
+bool isPure(instruction::Operation oper) {
+  switch (oper) {
+  case instruction::_ADD :  case instruction::_SUB :  case instruction::_MUL :
+  case instruction::_DIV :  case instruction::_AND :  case instruction::_OR :
+  case instruction::_EQ :   case instruction::_LT :   case instruction::_LE :
+  case instruction::_FADD : case instruction::_FSUB : case instruction::_FMUL :
+  case instruction::_FDIV : case instruction::_FEQ :  case instruction::_FLT :
+  case instruction::_FLE :  case instruction::_NOT :  case instruction::_NEG :
+  case instruction::_FNEG : case instruction::_FLOAT :
+  case instruction::_MOD :  case instruction::_NE :   case instruction::_GT :
+  case instruction::_GE :   case instruction::_FNE :  case instruction::_FGT :
+  case instruction::_FGE :
+  case instruction::_LOAD : case instruction::_ILOAD : case instruction::_FLOAD :
+  case instruction::_CHLOAD : case instruction::_ALOAD :
+  case instruction::_LOADX : case instruction::_LOADC : return true;
+  default : return false;
+  }
+}
+
+// instructions that may stop the VM (division by zero, bad index)
+bool mayFail(instruction::Operation oper) {
+  return oper == instruction::_DIV   or oper == instruction::_FDIV or
+         oper == instruction::_MOD   or oper == instruction::_LOADX or
+         oper == instruction::_LOADC;
+}
+
+}  // namespace
+
+
+// ======================================================================
+// class LoopInvariant
+
+// ----------------------------------------------------------------------
+// constructor
+
+LoopInvariant::LoopInvariant() :
+  loops(0), hoisted(0) {
+}
+
+// ----------------------------------------------------------------------
+// optimization
+
+void LoopInvariant::optimize(code & c) {
+  for (auto & subr : c.get_subroutines())
+    optimize(subr);
+}
+
+void LoopInvariant::optimize(subroutine & subr) {
+  instructionList lins = subr.get_instructions();
+  std::set<std::string> localVars, addressTaken;
+  for (auto & v : subr.vars)
+    localVars.insert(v.name);
+  for (auto & inst : lins)
+    if (inst.oper == instruction::_ALOAD) addressTaken.insert(inst.arg2);
+
+  // each hoisting moves instructions, so the CFG is rebuilt after it.
+  // Loops are identified by the label starting their header
+  std::set<std::string> done;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    CFG cfg(lins);
+    for (auto & loop : cfg.getLoops()) {
+      const instruction & first = lins[cfg.getBlock(loop.header).first];
+      if (first.oper != instruction::_LABEL or done.count(first.arg1)) continue;
+      done.insert(first.arg1);
+      if (hoistLoop(lins, cfg, loop, localVars, addressTaken)) {
+        changed = true;
+        break;
+      }
+    }
+  }
+  subr.set_instructions(lins);
+}
+
+bool LoopInvariant::hoistLoop(instructionList & lins, const CFG & cfg, const CFG::Loop & loop,
+                              const std::set<std::string> & localVars,
+                              const std::set<std::string> & addressTaken) {
+  const CFG::BasicBlock & header = cfg.getBlock(loop.header);
+  std::size_t n = lins.size();
+  std::vector<bool> inLoop(n);
+  for (std::size_t pos = 0; pos < n; ++pos)
+    inLoop[pos] = loop.blocks.count(cfg.getBlockOf(pos)) > 0;
+
+  // the preheader goes just before the header: there must be no
+  // block of the loop falling through into it
+  if (header.first > 0 and inLoop[header.first-1] and
+      lins[header.first-1].oper != instruction::_UJUMP and
+      not lins[header.first-1].isReturn())
+    return false;
+
+  // what the loop defines and writes
+  std::map<std::string, std::size_t> defsInLoop, defPos;
+  std::map<std::string, std::vector<std::size_t>> usePos;
+  std::set<std::string> stores;
+  bool hasCall = false, hasCheck = false;
+  for (std::size_t pos = 0; pos < n; ++pos) {
+    const instruction & inst = lins[pos];
+    for (auto & name : inst.uses())
+      usePos[name].push_back(pos);
+    if (not inLoop[pos]) continue;
+    std::string d = inst.defines();
+    if (not d.empty()) {
+      ++defsInLoop[d];
+      defPos[d] = pos;
+    }
+    if (inst.oper == instruction::_XLOAD or inst.oper == instruction::_MEMCPY)
+      stores.insert(localVars.count(inst.arg1) ? inst.arg1 : "*");
+    else if (inst.oper == instruction::_CLOAD)
+      stores.insert("*");
+    else if (inst.oper == instruction::_CALL)
+      hasCall = true;
+    else if (inst.oper == instruction::_CHECK)
+      hasCheck = true;
+  }
+  std::vector<std::size_t> exits;
+  for (auto b : loop.blocks)
+    for (auto s : cfg.getBlock(b).succs)
+      if (not loop.blocks.count(s)) exits.push_back(b);
+
+  // mark invariant instructions until no more are found
+  std::vector<bool> invariant(n, false);
+  auto isInvariant = [&](std::size_t pos) {
+    const instruction & inst = lins[pos];
+    std::string d = inst.defines();
+    if (not isPure(inst.oper) or not instruction::isTemp(d) or defsInLoop[d] != 1) return false;
+    for (auto q : usePos[d])
+      if (q <= pos or cfg.getBlockOf(q) != cfg.getBlockOf(pos)) return false;
+    for (auto & name : inst.uses())
+      if (defsInLoop[name] > 0 and not invariant[defPos[name]]) return false;
+    if (inst.oper == instruction::_LOADX or inst.oper == instruction::_LOADC) {
+      std::string mem = (inst.oper == instruction::_LOADX and localVars.count(inst.arg2)) ?
+                        inst.arg2 : "*";
+      if (hasCall or stores.count(mem)) return false;
+      if (mem == "*")
+        for (auto & m : stores)
+          if (addressTaken.count(m)) return false;
+      if (addressTaken.count(mem) and stores.count("*")) return false;
+    }
+    // a bounds check in the loop may be what guards it
+    if (mayFail(inst.oper) and hasCheck) return false;
+    if (mayFail(inst.oper))
+      for (auto b : exits)
+        if (not cfg.dominates(cfg.getBlockOf(pos), b)) return false;
+    return true;
+  };
+  std::size_t count = 0;
+  bool found = true;
+  while (found) {
+    found = false;
+    for (std::size_t pos = 0; pos < n; ++pos)
+      if (inLoop[pos] and not invariant[pos] and isInvariant(pos)) {
+        invariant[pos] = true;
+        found = true;
+        ++count;
+      }
+  }
+  if (count == 0) return false;
+
+  // labels of the header: jumps to them from outside the loop have to
+  // go through the preheader
+  std::set<std::string> headerLabels, allLabels;
+  for (std::size_t pos = header.first; pos < header.last and
+                   lins[pos].oper == instruction::_LABEL; ++pos)
+    headerLabels.insert(lins[pos].arg1);
+  for (auto & inst : lins)
+    if (inst.oper == instruction::_LABEL) allLabels.insert(inst.arg1);
+  std::string preheader = "pre" + lins[header.first].arg1;
+  while (allLabels.count(preheader)) preheader = "pre" + preheader;
+
+  instructionList newLins;
+  for (std::size_t pos = 0; pos < n; ++pos) {
+    if (pos == header.first) {
+      newLins.push_back(instruction::LABEL(preheader));
+      for (std::size_t p = 0; p < n; ++p)
+        if (invariant[p]) newLins.push_back(lins[p]);
+    }
+    if (invariant[pos]) continue;
+    instruction inst = lins[pos];
+    if (not inLoop[pos] and not inst.isReturn() and inst.isJump() and
+        headerLabels.count(inst.jumpTarget()))
+      inst.setJumpTarget(preheader);
+    newLins.push_back(inst);
+  }
+  lins = newLins;
+  ++loops;
+  hoisted += count;
+  return true;
+}
+
+// ----------------------------------------------------------------------
+// statistics
+
+std::string LoopInvariant::dumpStats() const {
+  return "licm: loops                 " + std::to_string(loops) + "\n" +
+         "licm: hoisted               " + std::to_string(hoisted) + "\n";
+}
@@ -0,0 +1,68 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    LoopInvariant - Loop-invariant code motion for t-code
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+#include "CFG.h"
+
+#include <set>
+#include <string>
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Class LoopInvariant: moves the computations whose value does not
+// change while a loop runs (constants, pointer loads of array
+// parameters, expressions on variables not modified in the loop...)
+// to a preheader placed just before the loop header, so that they
+// are executed once instead of once per iteration. Inner loops are
+// processed first, so an invariant can move out of several loops.
+//
+// An instruction is hoisted when:
+//   - it defines a temporal, only once in the loop, and that
+//     temporal is only used after it in the same basic block,
+//   - it has no side effects and all its operands are defined
+//     outside the loop or by instructions already hoisted,
+//   - for array reads (a[i], *p): the loop has no calls and no
+//     writes to memory that may be the same array (see
+//     ValueNumbering for the aliasing rules),
+//   - for instructions that can stop the VM (divisions and array
+//     reads): it is executed in every iteration, i.e. it is in a
+//     block dominating all the exits of the loop, and the loop has
+//     no bounds checks (checked mode), which could be guarding it.
+
+class LoopInvariant {
+
+public:
+
+  // Constructor
+  LoopInvariant();
+
+  // Optimize all the subroutines of the program
+  void optimize(code & c);
+  // Optimize a single subroutine
+  void optimize(subroutine & subr);
+
+  // What has been done (one line per counter)
+  std::string dumpStats() const;
+
+private:
+
+  // loops with some instruction hoisted
+  std::size_t loops;
+  // instructions hoisted
+  std::size_t hoisted;
+
+  // Hoist the invariant instructions of a loop to its preheader.
+  // Returns true if some instruction has been hoisted
+  bool hoistLoop(instructionList & lins, const CFG & cfg, const CFG::Loop & loop,
+                 const std::set<std::string> & localVars,
+                 const std::set<std::string> & addressTaken);
+
+};  // class LoopInvariant
@@ -0,0 +1,147 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    LoopRotation - Loop inversion: while loops become a guard
+//                   test plus a loop tested at the bottom
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "LoopRotation.h"
+
+#include <set>
+#include <string>
+#include <algorithm>  // std::max
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+// ======================================================================
+// class LoopRotation
+
+// ----------------------------------------------------------------------
+// constructor
+
+LoopRotation::LoopRotation() :
+  rotated(0) {
+}
+
+// ----------------------------------------------------------------------
+// optimization
+
+void LoopRotation::optimize(code & c) {
+  for (auto & subr : c.get_subroutines())
+    optimize(subr);
+}
+
+void LoopRotation::optimize(subroutine & subr) {
+  instructionList lins = subr.get_instructions();
+  // new temporals (for the negated conditions) are numbered after the
+  // ones already used
+  int lastTemp = 0;
+  for (auto & inst : lins) {
+    lastTemp = std::max(lastTemp, instruction::tempNumber(inst.arg1));
+    lastTemp = std::max(lastTemp, instruction::tempNumber(inst.arg2));
+    lastTemp = std::max(lastTemp, instruction::tempNumber(inst.arg3));
+  }
+
+  // each rotation moves instructions, so the search starts again
+  // after it. Labels already tried are not tried again
+  std::set<std::string> tried;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (std::size_t h = 0; h < lins.size(); ++h) {
+      if (lins[h].oper != instruction::_LABEL or tried.count(lins[h].arg1)) continue;
+      tried.insert(lins[h].arg1);
+      if (rotate(lins, h, lastTemp)) {
+        ++rotated;
+        changed = true;
+        break;
+      }
+    }
+  }
+  subr.set_instructions(lins);
+}
+
+bool LoopRotation::rotate(instructionList & lins, std::size_t h, int & lastTemp) {
+  std::size_t n = lins.size();
+  std::string loopLabel = lins[h].arg1;
+
+  // the condition, up to the ifFalse (or compare-and-jump) leaving
+  // the loop
+  std::size_t f = h+1;
+  while (f < n and not lins[f].isJump() and lins[f].oper != instruction::_LABEL) ++f;
+  if (f >= n or not lins[f].isCondJump()) return false;
+  bool fused = lins[f].oper != instruction::_FJUMP;
+  std::string cond = fused ? "" : lins[f].arg1;
+  std::string endLabel = lins[f].jumpTarget();
+
+  // the back jump must be the only jump to the header
+  std::size_t latch = n;
+  std::size_t refs = 0, condUses = 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    const instruction & inst = lins[i];
+    if ((inst.oper == instruction::_UJUMP or inst.isCondJump()) and
+        inst.jumpTarget() == loopLabel) {
+      ++refs;
+      if (inst.oper == instruction::_UJUMP and i > f) latch = i;
+    }
+    for (auto & name : inst.uses())
+      if (name == cond) ++condUses;
+  }
+  if (refs != 1 or latch == n) return false;
+
+  // bottom test: jump back to the body if the condition is true
+  instructionList condCode;
+  condCode.insert(condCode.end(), lins.begin()+h+1, lins.begin()+f);
+  instructionList bottom = condCode;
+  bool onlyTest = instruction::isTemp(cond) and condUses == 1 and not bottom.empty() and
+                  bottom.back().arg1 == cond;
+  if (fused) {
+    const instruction & exit = lins[f];
+    bottom.push_back(instruction(instruction::negatedJump(exit.oper),
+                                 exit.arg1, exit.arg2, loopLabel));
+  }
+  else if (onlyTest and bottom.back().oper == instruction::_NOT) {
+    std::string negated = bottom.back().arg2;
+    bottom.pop_back();
+    bottom.push_back(instruction::FJUMP(negated, loopLabel));
+  }
+  else if (onlyTest and bottom.back().oper == instruction::_LT) {
+    instruction cmp = bottom.back();
+    bottom.back() = instruction::LE(cmp.arg1, cmp.arg3, cmp.arg2);
+    bottom.push_back(instruction::FJUMP(cond, loopLabel));
+  }
+  else if (onlyTest and bottom.back().oper == instruction::_LE) {
+    instruction cmp = bottom.back();
+    bottom.back() = instruction::LT(cmp.arg1, cmp.arg3, cmp.arg2);
+    bottom.push_back(instruction::FJUMP(cond, loopLabel));
+  }
+  else {
+    std::string temp = "%" + std::to_string(++lastTemp);
+    bottom.push_back(instruction::NOT(temp, cond));
+    bottom.push_back(instruction::FJUMP(temp, loopLabel));
+  }
+  // leaving the loop from the bottom test must reach the end label
+  bool endFollows = false;
+  for (std::size_t i = latch+1; i < n and lins[i].oper == instruction::_LABEL; ++i)
+    if (lins[i].arg1 == endLabel) endFollows = true;
+  if (not endFollows)
+    bottom.push_back(instruction::UJUMP(endLabel));
+
+  instructionList newLins;
+  newLins.insert(newLins.end(), lins.begin(), lins.begin()+h);
+  newLins = newLins || condCode || lins[f] || instruction::LABEL(loopLabel);
+  newLins.insert(newLins.end(), lins.begin()+f+1, lins.begin()+latch);
+  newLins = newLins || bottom;
+  newLins.insert(newLins.end(), lins.begin()+latch+1, lins.end());
+  lins = newLins;
+  return true;
+}
+
+// ----------------------------------------------------------------------
+// statistics
+
+std::string LoopRotation::dumpStats() const {
+  return "rotate: loops              " + std::to_string(rotated) + "\n";
+}
@@ -0,0 +1,70 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    LoopRotation - Loop inversion: while loops become a guard
+//                   test plus a loop tested at the bottom
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <string>
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Class LoopRotation: rewrites the loops generated for while
+// statements (and for array assignments)
+//
+//     label W :                          C
+//     C                                  ifFalse c goto E
+//     ifFalse c goto E        ==>     label W :
+//     B                                  B
+//     goto W                             C'
+//   label E :                            ifFalse c' goto W
+//                                      label E :
+//
+// so that each iteration runs one jump instead of two. C is the code
+// of the condition, which is evaluated once more before the loop (the
+// guard), as in the original loop. Since t-code only has ifFalse, the
+// bottom test needs the negation of c:
+//   - if c = not x, the not is dropped and x is tested,
+//   - if c = a < b or c = a <= b (integers), the comparison is
+//     reversed (b <= a, b < a),
+//   - otherwise a 'not' is added.
+// If the loop is left with a compare-and-jump (if<cmp> a b goto E,
+// extended instruction set) the bottom test is the opposite one
+// (if<not cmp> a b goto W).
+//
+// Loops are only rotated when W is just the target of the back jump
+// and the condition has no labels nor jumps (i.e. the shape produced
+// by CodeGenVisitor).
+
+class LoopRotation {
+
+public:
+
+  // Constructor
+  LoopRotation();
+
+  // Rotate the loops of all the subroutines of the program
+  void optimize(code & c);
+  // Rotate the loops of a single subroutine
+  void optimize(subroutine & subr);
+
+  // What has been done (one line per counter)
+  std::string dumpStats() const;
+
+private:
+
+  // loops rotated
+  std::size_t rotated;
+
+  // Rotate the loop whose header label is at position h, if it has
+  // the expected shape. Returns true if the loop has been rotated
+  bool rotate(instructionList & lins, std::size_t h, int & lastTemp);
+
+};  // class LoopRotation
@@ -0,0 +1,235 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    Peephole - Table-driven peephole optimizer for the t-code
+//               generated by CodeGenVisitor
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "Peephole.h"
+
+#include <set>
+#include <string>
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+// ======================================================================
+// Auxiliary functions shared by the rules
+
+// goto, ifFalse or compare-and-jump (the jumps with a label)
+static bool isGotoOrIfFalse(const instruction & inst) {
+  return inst.oper == instruction::_UJUMP or inst.isCondJump();
+}
+
+// position of the first instruction at or after pos that is not a label
+static std::size_t skipLabels(const instructionList & lins, std::size_t pos) {
+  while (pos < lins.size() and lins[pos].oper == instruction::_LABEL) ++pos;
+  return pos;
+}
+
+// true if 'label' is one of the labels placed just after position i,
+// i.e. jumping to it from i is the same as falling through
+static bool labelFollows(const instructionList & lins, std::size_t i,
+                         const std::string & label) {
+  for (std::size_t k = i+1; k < lins.size() and lins[k].oper == instruction::_LABEL; ++k)
+    if (lins[k].arg1 == label) return true;
+  return false;
+}
+
+
+// ======================================================================
+// Rules
+
+// t1 = a < b ; t = not t1   ==>   t = b <= a
+// t1 = a <= b; t = not t1   ==>   t = b < a
+// (codegen for >, >= on integers and chars). Float comparisons are
+// left alone since the rewriting is not valid for NaN operands.
+static bool foldNotCompare(instructionList & lins, std::size_t i,
+                           const Peephole::Context & ctx) {
+  if (i+1 >= lins.size()) return false;
+  instruction & cmp = lins[i];
+  const instruction & neg = lins[i+1];
+  if (cmp.oper != instruction::_LT and cmp.oper != instruction::_LE) return false;
+  if (neg.oper != instruction::_NOT or neg.arg2 != cmp.arg1) return false;
+  if (not instruction::isTemp(cmp.arg1) or ctx.uses.at(cmp.arg1) != 1) return false;
+  if (cmp.oper == instruction::_LT)
+    cmp = instruction::LE(neg.arg1, cmp.arg3, cmp.arg2);
+  else
+    cmp = instruction::LT(neg.arg1, cmp.arg3, cmp.arg2);
+  lins.erase(lins.begin()+i+1);
+  return true;
+}
+
+// t = not c; ifFalse t goto L1; goto L2; label L1 :
+//   ==>   ifFalse c goto L2; label L1 :
+static bool invertBranch(instructionList & lins, std::size_t i,
+                         const Peephole::Context & ctx) {
+  if (i+3 >= lins.size()) return false;
+  const instruction & neg = lins[i];
+  const instruction & fjump = lins[i+1];
+  const instruction & ujump = lins[i+2];
+  if (neg.oper != instruction::_NOT or fjump.oper != instruction::_FJUMP or
+      ujump.oper != instruction::_UJUMP) return false;
+  if (fjump.arg1 != neg.arg1 or not instruction::isTemp(neg.arg1) or ctx.uses.at(neg.arg1) != 1)
+    return false;
+  if (not labelFollows(lins, i+2, fjump.arg2)) return false;
+  instruction inverted = instruction::FJUMP(neg.arg2, ujump.arg1);
+  lins.erase(lins.begin()+i+1, lins.begin()+i+3);
+  lins[i] = inverted;
+  return true;
+}
+
+// if<cmp> a b goto L1; goto L2; label L1 :
+//   ==>   if<not cmp> a b goto L2; label L1 :
+static bool invertCompareJump(instructionList & lins, std::size_t i,
+                              const Peephole::Context & ctx) {
+  if (i+2 >= lins.size()) return false;
+  const instruction & cjump = lins[i];
+  const instruction & ujump = lins[i+1];
+  instruction::Operation negated = instruction::negatedJump(cjump.oper);
+  if (negated == instruction::_INVALID or ujump.oper != instruction::_UJUMP) return false;
+  if (not labelFollows(lins, i+1, cjump.arg3)) return false;
+  instruction inverted(negated, cjump.arg1, cjump.arg2, ujump.arg1);
+  lins.erase(lins.begin()+i+1);
+  lins[i] = inverted;
+  return true;
+}
+
+// goto L1 ... label L1 : goto L2   ==>   goto L2 ... label L1 : goto L2
+// (also for ifFalse). The whole chain is followed at once.
+static bool threadJump(instructionList & lins, std::size_t i,
+                       const Peephole::Context & ctx) {
+  if (i >= lins.size() or not isGotoOrIfFalse(lins[i])) return false;
+  std::string target = lins[i].jumpTarget();
+  std::set<std::string> visited;
+  visited.insert(target);
+  while (true) {
+    std::size_t j = skipLabels(lins, ctx.labelPos.at(target)+1);
+    if (j >= lins.size() or lins[j].oper != instruction::_UJUMP) break;
+    // a loop made only of gotos: leave it as it is
+    if (visited.count(lins[j].arg1)) return false;
+    target = lins[j].arg1;
+    visited.insert(target);
+  }
+  if (target == lins[i].jumpTarget()) return false;
+  lins[i].setJumpTarget(target);
+  return true;
+}
+
+// goto L ... label L : return   ==>   return ... label L : return
+static bool jumpToReturn(instructionList & lins, std::size_t i,
+                         const Peephole::Context & ctx) {
+  if (i >= lins.size() or lins[i].oper != instruction::_UJUMP) return false;
+  std::size_t j = skipLabels(lins, ctx.labelPos.at(lins[i].arg1)+1);
+  if (j >= lins.size() or lins[j].oper != instruction::_RETURN) return false;
+  lins[i] = instruction::RETURN();
+  return true;
+}
+
+// goto L; label L :   ==>   label L :   (also for ifFalse)
+static bool jumpToNext(instructionList & lins, std::size_t i,
+                       const Peephole::Context & ctx) {
+  if (i >= lins.size() or not isGotoOrIfFalse(lins[i])) return false;
+  if (not labelFollows(lins, i, lins[i].jumpTarget())) return false;
+  lins.erase(lins.begin()+i);
+  return true;
+}
+
+// goto L; x = y   ==>   goto L   (until the next label)
+static bool unreachable(instructionList & lins, std::size_t i,
+                        const Peephole::Context & ctx) {
+  if (i+1 >= lins.size()) return false;
+  if (lins[i].oper != instruction::_UJUMP and not lins[i].isReturn()) return false;
+  if (lins[i+1].oper == instruction::_LABEL) return false;
+  lins.erase(lins.begin()+i+1);
+  return true;
+}
+
+// label L :   ==>   (nothing), if there are no jumps to L
+static bool deadLabel(instructionList & lins, std::size_t i,
+                      const Peephole::Context & ctx) {
+  if (i >= lins.size() or lins[i].oper != instruction::_LABEL) return false;
+  if (ctx.labelRefs.count(lins[i].arg1)) return false;
+  lins.erase(lins.begin()+i);
+  return true;
+}
+
+
+// ======================================================================
+// class Peephole
+
+const Peephole::RuleEntry Peephole::Rules[] = {
+  { "fold-not-compare", foldNotCompare },
+  { "invert-branch",    invertBranch   },
+  { "invert-cmp-jump",  invertCompareJump },
+  { "thread-jump",      threadJump     },
+  { "jump-to-return",   jumpToReturn   },
+  { "jump-to-next",     jumpToNext     },
+  { "unreachable",      unreachable    },
+  { "dead-label",       deadLabel      },
+};
+
+const std::size_t Peephole::NumRules = sizeof(Peephole::Rules) / sizeof(Peephole::Rules[0]);
+
+// ----------------------------------------------------------------------
+// constructor
+
+Peephole::Peephole() :
+  fired(NumRules, 0) {
+}
+
+// ----------------------------------------------------------------------
+// optimization
+
+void Peephole::optimize(code & c) {
+  for (auto & subr : c.get_subroutines()) {
+    instructionList lins = subr.get_instructions();
+    optimize(lins);
+    subr.set_instructions(lins);
+  }
+}
+
+void Peephole::optimize(instructionList & lins) {
+  Context ctx = computeContext(lins);
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (std::size_t i = 0; i < lins.size(); ++i) {
+      for (std::size_t r = 0; r < NumRules; ++r) {
+        if (Rules[r].rule(lins, i, ctx)) {
+          ++fired[r];
+          changed = true;
+          ctx = computeContext(lins);
+        }
+      }
+    }
+  }
+}
+
+Peephole::Context Peephole::computeContext(const instructionList & lins) {
+  Context ctx;
+  for (std::size_t i = 0; i < lins.size(); ++i) {
+    const instruction & inst = lins[i];
+    if (inst.oper == instruction::_LABEL)
+      ctx.labelPos[inst.arg1] = i;
+    else if (isGotoOrIfFalse(inst))
+      ++ctx.labelRefs[inst.jumpTarget()];
+    for (auto & name : inst.uses())
+      ++ctx.uses[name];
+  }
+  return ctx;
+}
+
+// ----------------------------------------------------------------------
+// statistics
+
+std::string Peephole::dumpStats() const {
+  std::string s;
+  for (std::size_t r = 0; r < NumRules; ++r) {
+    std::string name = Rules[r].name;
+    s += "peephole: " + name + std::string(18 - name.size(), ' ') +
+         std::to_string(fired[r]) + "\n";
+  }
+  return s;
+}
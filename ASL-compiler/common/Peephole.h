@@ -0,0 +1,78 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    Peephole - Table-driven peephole optimizer for the t-code
+//               generated by CodeGenVisitor
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Class Peephole: rewrites the instruction list of each subroutine
+// applying a table of local rules until none of them fires anymore.
+// Every rule looks at the instructions starting at one position of
+// the list and, if its pattern matches, rewrites them in place.
+// The number of times each rule has fired is kept so that it can be
+// reported (asl -O --stats).
+//
+// To add a new rule write a function with the Rule signature and add
+// an entry to the table Peephole::Rules (in Peephole.cpp).
+
+class Peephole {
+
+public:
+
+  // Information about the whole instruction list that rules may use
+  // to decide if they can be applied. It is recomputed after each
+  // rewriting, so rules do not have to keep it up to date.
+  struct Context {
+    // label name -> position of the label in the list
+    std::map<std::string, std::size_t> labelPos;
+    // label name -> number of jumps (goto, ifFalse, if<cmp>) to the label
+    std::map<std::string, std::size_t> labelRefs;
+    // variable/temporal name -> number of instructions reading it
+    std::map<std::string, std::size_t> uses;
+  };
+
+  // A rule tries to rewrite lins at position i. Returns true if the
+  // rule has been applied (and therefore lins has changed)
+  typedef bool (*Rule)(instructionList & lins, std::size_t i, const Context & ctx);
+
+  // Constructor
+  Peephole();
+
+  // Optimize the instructions of all subroutines of the program
+  void optimize(code & c);
+  // Optimize a single instruction list
+  void optimize(instructionList & lins);
+
+  // Number of times each rule has been applied (one line per rule)
+  std::string dumpStats() const;
+
+private:
+
+  // Entry of the table of rules
+  struct RuleEntry {
+    const char * name;
+    Rule         rule;
+  };
+  static const RuleEntry Rules[];
+  static const std::size_t NumRules;
+
+  // Times each rule (same index as in Rules) has fired
+  std::vector<std::size_t> fired;
+
+  // Compute the context of an instruction list
+  static Context computeContext(const instructionList & lins);
+
+};  // class Peephole
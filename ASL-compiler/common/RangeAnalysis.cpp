@@ -0,0 +1,327 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    RangeAnalysis - Value-range analysis of the integer variables,
+//                    to remove the array bounds checks it proves
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "RangeAnalysis.h"
+
+#include <algorithm>  // std::min, std::max
+#include <cstdlib>    // std::atoll
+
+// using namespace std;
+
+
+// ======================================================================
+// Auxiliary functions
+
+namespace {
+
+// limits of the integers of the VM
+const long long MinInt = -2147483648LL;
+const long long MaxInt =  2147483647LL;
+
+bool isIntegerCompare(instruction::Operation oper) {
+  return oper == instruction::_EQ or oper == instruction::_NE or
+         oper == instruction::_LT or oper == instruction::_LE or
+         oper == instruction::_GT or oper == instruction::_GE;
+}
+
+// comparison done by an integer compare-and-jump (_INVALID otherwise)
+instruction::Operation jumpCompare(instruction::Operation oper) {
+  switch (oper) {
+  case instruction::_IFEQ : return instruction::_EQ;
+  case instruction::_IFNE : return instruction::_NE;
+  case instruction::_IFLT : return instruction::_LT;
+  case instruction::_IFLE : return instruction::_LE;
+  case instruction::_IFGT : return instruction::_GT;
+  case instruction::_IFGE : return instruction::_GE;
+  default :                 return instruction::_INVALID;
+  }
+}
+
+// whether 'name' is written by an instruction in [from, to)
+bool changedIn(const instructionList & lins, std::size_t from, std::size_t to,
+               const std::string & name) {
+  for (std::size_t pos = from; pos < to; ++pos)
+    if (lins[pos].defines() == name) return true;
+  return false;
+}
+
+}  // namespace
+
+
+// ======================================================================
+// class RangeAnalysis
+
+// ----------------------------------------------------------------------
+// constructor
+
+RangeAnalysis::RangeAnalysis() :
+  checks(0), removed(0) {
+}
+
+// ----------------------------------------------------------------------
+// optimization
+
+void RangeAnalysis::optimize(code & c) {
+  for (auto & subr : c.get_subroutines())
+    optimize(subr);
+}
+
+void RangeAnalysis::optimize(subroutine & subr) {
+  instructionList lins = subr.get_instructions();
+  std::size_t found = 0;
+  for (auto & inst : lins)
+    if (inst.oper == instruction::_CHECK) ++found;
+  if (found == 0) return;
+  addressTaken.clear();
+  for (auto & inst : lins)
+    if (inst.oper == instruction::_ALOAD) addressTaken.insert(inst.arg2);
+
+  // intervals at the beginning of each block, until they do not change
+  CFG cfg(lins);
+  std::size_t n = cfg.getNumBlocks();
+  std::vector<State> in(n);
+  std::vector<bool> reached(n, false);
+  std::vector<std::size_t> visits(n, 0);
+  std::set<std::size_t> headers;
+  for (auto & loop : cfg.getLoops())
+    headers.insert(loop.header);
+  std::set<std::size_t> pending;
+  reached[0] = true;
+  pending.insert(0);
+  while (not pending.empty()) {
+    std::size_t b = *pending.begin();
+    pending.erase(pending.begin());
+    const CFG::BasicBlock & block = cfg.getBlock(b);
+    State st = in[b];
+    for (std::size_t pos = block.first; pos < block.last; ++pos)
+      transfer(lins[pos], st);
+
+    // what the jump ending the block tells on each edge
+    const instruction & last = lins[block.last-1];
+    std::vector<Fact> taken, notTaken;
+    if (last.oper == instruction::_FJUMP) {
+      conditionFacts(lins, block.first, block.last-1, block.last-1, last.arg1, false, taken);
+      conditionFacts(lins, block.first, block.last-1, block.last-1, last.arg1, true, notTaken);
+    }
+    else if (jumpCompare(last.oper) != instruction::_INVALID) {
+      instruction::Operation cmp = jumpCompare(last.oper);
+      taken.push_back(Fact{cmp, last.arg1, last.arg2});
+      notTaken.push_back(Fact{instruction::negatedCompare(cmp), last.arg1, last.arg2});
+    }
+    std::size_t target = last.isCondJump() ? cfg.getLabelBlock(last.jumpTarget()) : n;
+
+    for (auto s : block.succs) {
+      State out = st;
+      bool possible = true;
+      if (target != b+1 and s == target)
+        for (auto & f : taken) possible = possible and apply(f, out);
+      else if (target != b+1 and last.isCondJump())
+        for (auto & f : notTaken) possible = possible and apply(f, out);
+      if (not possible) continue;
+
+      // join with what was already known (widened at the loop headers
+      // if it keeps changing)
+      State joined;
+      bool widen = reached[s] and headers.count(s) and ++visits[s] > 2;
+      if (not reached[s])
+        joined = out;
+      else
+        for (auto & kv : in[s]) {
+          auto it = out.find(kv.first);
+          if (it == out.end()) continue;
+          Range r{std::min(kv.second.lo, it->second.lo), std::max(kv.second.hi, it->second.hi)};
+          if (widen) {
+            if (r.lo < kv.second.lo) r.lo = MinInt;
+            if (r.hi > kv.second.hi) r.hi = MaxInt;
+          }
+          setRange(joined, kv.first, r);
+        }
+      if (reached[s] and joined == in[s]) continue;
+      reached[s] = true;
+      in[s] = joined;
+      pending.insert(s);
+    }
+  }
+
+  // remove the checks whose index is known to be in range
+  std::vector<bool> proven(lins.size(), false);
+  for (std::size_t b = 0; b < n; ++b) {
+    if (not reached[b]) continue;
+    const CFG::BasicBlock & block = cfg.getBlock(b);
+    State st = in[b];
+    for (std::size_t pos = block.first; pos < block.last; ++pos) {
+      const instruction & inst = lins[pos];
+      if (inst.oper == instruction::_CHECK) {
+        Range r = rangeOf(st, inst.arg1);
+        proven[pos] = (r.lo >= 0 and r.hi < std::atoll(inst.arg2.c_str()));
+      }
+      transfer(inst, st);
+    }
+  }
+  instructionList kept;
+  std::size_t count = 0;
+  for (std::size_t pos = 0; pos < lins.size(); ++pos) {
+    if (proven[pos]) ++count;
+    else             kept.push_back(lins[pos]);
+  }
+  checks += found;
+  removed += count;
+  report.push_back("range: " + subr.get_name() + ": removed " + std::to_string(count) +
+                   " of " + std::to_string(found) + " checks");
+  subr.set_instructions(kept);
+}
+
+// ----------------------------------------------------------------------
+// intervals
+
+RangeAnalysis::Range RangeAnalysis::rangeOf(const State & st, const std::string & name) {
+  if (instruction::operandKind(name) == instruction::_INTIMM) {
+    long long k = std::atoll(name.c_str());
+    return Range{k, k};
+  }
+  auto it = st.find(name);
+  if (it != st.end()) return it->second;
+  return Range{MinInt, MaxInt};
+}
+
+void RangeAnalysis::setRange(State & st, const std::string & name, const Range & r) const {
+  if (r.lo > MinInt or r.hi < MaxInt) {
+    if (addressTaken.count(name)) return;
+    // a result that may not fit in an integer may overflow
+    if (r.lo < MinInt or r.hi > MaxInt) st.erase(name);
+    else                                st[name] = r;
+  }
+  else
+    st.erase(name);
+}
+
+void RangeAnalysis::transfer(const instruction & inst, State & st) const {
+  std::string d = inst.defines();
+  Range a = rangeOf(st, inst.arg2), b = rangeOf(st, inst.arg3);
+  switch (inst.oper) {
+  case instruction::_CHECK : {
+    Range r = rangeOf(st, inst.arg1);
+    if (instruction::operandKind(inst.arg1) == instruction::_NAME)
+      setRange(st, inst.arg1, Range{std::max(r.lo, 0LL),
+                                    std::min(r.hi, std::atoll(inst.arg2.c_str()) - 1)});
+    break;
+  }
+  case instruction::_ILOAD : {
+    long long k = std::atoll(inst.arg2.c_str());
+    setRange(st, d, Range{k, k});
+    break;
+  }
+  case instruction::_LOAD : { setRange(st, d, a); break; }
+  case instruction::_ADD : { setRange(st, d, Range{a.lo + b.lo, a.hi + b.hi}); break; }
+  case instruction::_SUB : { setRange(st, d, Range{a.lo - b.hi, a.hi - b.lo}); break; }
+  case instruction::_MUL : {
+    long long p[] = {a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi};
+    setRange(st, d, Range{*std::min_element(p, p+4), *std::max_element(p, p+4)});
+    break;
+  }
+  case instruction::_DIV : {
+    if (b.lo == b.hi and b.lo > 0) setRange(st, d, Range{a.lo / b.lo, a.hi / b.lo});
+    else                           st.erase(d);
+    break;
+  }
+  case instruction::_MOD : {
+    // the remainder has the sign of the dividend
+    long long m = b.hi - 1;
+    if (b.lo <= 0)      st.erase(d);
+    else if (a.lo >= 0) setRange(st, d, Range{0, std::min(a.hi, m)});
+    else if (a.hi <= 0) setRange(st, d, Range{std::max(a.lo, -m), 0});
+    else                setRange(st, d, Range{-m, m});
+    break;
+  }
+  case instruction::_NEG : { setRange(st, d, Range{-a.hi, -a.lo}); break; }
+  case instruction::_EQ :  case instruction::_NE :  case instruction::_LT :
+  case instruction::_LE :  case instruction::_GT :  case instruction::_GE :
+  case instruction::_FEQ : case instruction::_FNE : case instruction::_FLT :
+  case instruction::_FLE : case instruction::_FGT : case instruction::_FGE :
+  case instruction::_NOT : case instruction::_AND : case instruction::_OR : {
+    setRange(st, d, Range{0, 1});
+    break;
+  }
+  default : {
+    if (not d.empty()) st.erase(d);
+    break;
+  }
+  }
+}
+
+void RangeAnalysis::conditionFacts(const instructionList & lins, std::size_t first,
+                                   std::size_t pos, std::size_t end, const std::string & name,
+                                   bool value, std::vector<Fact> & facts) {
+  // the instruction computing the condition
+  std::size_t k = pos;
+  while (k > first and lins[k-1].defines() != name) --k;
+  if (k == first or changedIn(lins, k, end, name)) return;
+  const instruction & inst = lins[k-1];
+  if (inst.oper == instruction::_NOT or inst.oper == instruction::_LOAD)
+    conditionFacts(lins, first, k-1, end, inst.arg2,
+                   inst.oper == instruction::_NOT ? not value : value, facts);
+  else if ((inst.oper == instruction::_AND and value) or
+           (inst.oper == instruction::_OR and not value)) {
+    conditionFacts(lins, first, k-1, end, inst.arg2, value, facts);
+    conditionFacts(lins, first, k-1, end, inst.arg3, value, facts);
+  }
+  else if (isIntegerCompare(inst.oper) and not changedIn(lins, k, end, inst.arg2) and
+           not changedIn(lins, k, end, inst.arg3))
+    facts.push_back(Fact{value ? inst.oper : instruction::negatedCompare(inst.oper),
+                         inst.arg2, inst.arg3});
+}
+
+bool RangeAnalysis::apply(const Fact & f, State & st) const {
+  // a > b is b < a, a >= b is b <= a
+  bool swap = (f.oper == instruction::_GT or f.oper == instruction::_GE);
+  const std::string & x = swap ? f.b : f.a;
+  const std::string & y = swap ? f.a : f.b;
+  Range a = rangeOf(st, x), b = rangeOf(st, y);
+  switch (f.oper) {
+  case instruction::_LT :
+  case instruction::_GT : {
+    a.hi = std::min(a.hi, b.hi - 1);
+    b.lo = std::max(b.lo, a.lo + 1);
+    break;
+  }
+  case instruction::_LE :
+  case instruction::_GE : {
+    a.hi = std::min(a.hi, b.hi);
+    b.lo = std::max(b.lo, a.lo);
+    break;
+  }
+  case instruction::_EQ : {
+    a.lo = b.lo = std::max(a.lo, b.lo);
+    a.hi = b.hi = std::min(a.hi, b.hi);
+    break;
+  }
+  case instruction::_NE : {
+    // only a constant at one end of the other interval can be excluded
+    if (b.lo == b.hi and a.lo == b.lo) ++a.lo;
+    else if (b.lo == b.hi and a.hi == b.lo) --a.hi;
+    if (a.lo == a.hi and b.lo == a.lo) ++b.lo;
+    else if (a.lo == a.hi and b.hi == a.lo) --b.hi;
+    break;
+  }
+  default : break;
+  }
+  if (a.lo > a.hi or b.lo > b.hi) return false;
+  if (instruction::operandKind(x) == instruction::_NAME) setRange(st, x, a);
+  if (instruction::operandKind(y) == instruction::_NAME) setRange(st, y, b);
+  return true;
+}
+
+// ----------------------------------------------------------------------
+// statistics
+
+std::string RangeAnalysis::dumpStats() const {
+  std::string s = "range: checks               " + std::to_string(checks) + "\n" +
+                  "range: removed              " + std::to_string(removed) + "\n";
+  for (auto & r : report)
+    s += r + "\n";
+  return s;
+}
@@ -0,0 +1,104 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    RangeAnalysis - Value-range analysis of the integer variables,
+//                    to remove the array bounds checks it proves
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+#include "CFG.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Class RangeAnalysis: computes, for each point of a subroutine, an
+// interval [lo, hi] containing the values that each variable and
+// temporal may have there, and removes the bounds checks
+// (check i n, generated in checked mode) whose index is known to be
+// in [0, n).
+//
+// It is a forward dataflow analysis over the CFG:
+//   - constants, copies, +, -, *, / and % by positive constants, and
+//     unary minus are computed on the intervals. A result that may
+//     not fit in a 32-bit integer is unknown, since it may overflow,
+//   - the conditions of the jumps (ifFalse of a comparison, maybe
+//     negated or combined with and/or, and the compare-and-jumps)
+//     restrict the intervals of their operands on each edge, so that
+//     in while (i < N) ... the body knows that i < N,
+//   - after a check i n, i is known to be in [0, n),
+//   - at the loop headers, once they have been reached three times,
+//     the bounds that keep changing are widened to the limits of the
+//     integers, which makes the analysis finish (the conditions of
+//     the loops bound them again in the bodies).
+// Variables whose address is taken (&a) are never known, and neither
+// is anything read from memory, a parameter or a float.
+
+class RangeAnalysis {
+
+public:
+
+  // Constructor
+  RangeAnalysis();
+
+  // Remove the proven checks of all the subroutines of the program
+  void optimize(code & c);
+  // Remove the proven checks of a single subroutine
+  void optimize(subroutine & subr);
+
+  // What has been done: counters plus one line per subroutine with
+  // bounds checks
+  std::string dumpStats() const;
+
+private:
+
+  // bounds checks found
+  std::size_t checks;
+  // bounds checks removed
+  std::size_t removed;
+  // checks removed in each subroutine, in the order they were seen
+  std::vector<std::string> report;
+
+  // Interval of values of an integer (lo <= hi)
+  struct Range {
+    long long lo, hi;
+    bool operator==(const Range & r) const { return lo == r.lo and hi == r.hi; }
+  };
+  // Known intervals at a point: the names not in the map may have any
+  // value
+  typedef std::map<std::string, Range> State;
+  // Fact given by a condition: 'a oper b' is true (oper is one of the
+  // integer comparisons)
+  struct Fact {
+    instruction::Operation oper;
+    std::string            a, b;
+  };
+
+  // Variables whose address is taken in the subroutine being analysed
+  std::set<std::string> addressTaken;
+
+  // interval of an operand (a name or an immediate constant)
+  static Range rangeOf(const State & st, const std::string & name);
+  // set the interval of a name (forgotten if it may have any value)
+  void setRange(State & st, const std::string & name, const Range & r) const;
+  // effect of an instruction on the intervals
+  void transfer(const instruction & inst, State & st) const;
+  // facts known when 'name', computed by the instructions in
+  // [first, pos), is equal to 'value', and whose operands are not
+  // changed before position 'end'
+  static void conditionFacts(const instructionList & lins, std::size_t first,
+                             std::size_t pos, std::size_t end, const std::string & name,
+                             bool value, std::vector<Fact> & facts);
+  // restrict the intervals with a fact. Returns false if it can not
+  // be true
+  bool apply(const Fact & f, State & st) const;
+
+};  // class RangeAnalysis
@@ -0,0 +1,206 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    TailCalls - Tail-call and self-recursion elimination
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "TailCalls.h"
+
+#include <map>
+#include <set>
+#include <vector>
+#include <algorithm>  // std::max, std::reverse
+
+// using namespace std;
+
+
+// ======================================================================
+// Auxiliary functions
+
+namespace {
+
+// whether the execution from position pos reaches the return of the
+// subroutine without doing anything else (only labels and gotos)
+bool leadsToReturn(const instructionList & lins, std::size_t pos,
+                   const std::map<std::string, std::size_t> & labelPos) {
+  for (std::size_t steps = 0; pos < lins.size() and steps <= lins.size(); ++steps) {
+    const instruction & inst = lins[pos];
+    if (inst.oper == instruction::_RETURN) return true;
+    if (inst.oper == instruction::_LABEL) ++pos;
+    else if (inst.oper == instruction::_UJUMP) pos = labelPos.at(inst.arg1);
+    else return false;
+  }
+  return false;
+}
+
+}  // namespace
+
+
+// ======================================================================
+// class TailCalls
+
+// ----------------------------------------------------------------------
+// constructor
+
+TailCalls::TailCalls(bool extended) :
+  extended(extended), selfCalls(0), tailCalls(0) {
+}
+
+// ----------------------------------------------------------------------
+// optimization
+
+void TailCalls::optimize(code & c) {
+  for (auto & subr : c.get_subroutines())
+    optimize(subr, c);
+}
+
+void TailCalls::optimize(subroutine & subr, const code & prog) {
+  instructionList lins = subr.get_instructions();
+  std::string name = subr.get_name();
+  bool function = subr.isFunction();
+  std::vector<std::string> params;
+  for (auto & p : subr.params)
+    if (p.name != "_result") params.push_back(p.name);
+
+  // what prevents each kind of elimination
+  bool hasLocalArray = false, paramAddress = false, varAddress = false;
+  for (auto & v : subr.vars)
+    if (v.size > 1) hasLocalArray = true;
+  for (auto & inst : lins)
+    if (inst.oper == instruction::_ALOAD) {
+      varAddress = true;
+      if (std::find(params.begin(), params.end(), inst.arg2) != params.end())
+        paramAddress = true;
+    }
+  bool selfOK = not hasLocalArray and not paramAddress;
+  bool tailOK = extended and not varAddress;
+  if (not selfOK and not tailOK) return;
+
+  std::map<std::string, std::size_t> labelPos;
+  std::set<std::string> labels;
+  std::map<std::string, std::size_t> uses;
+  int lastTemp = 0;
+  for (std::size_t i = 0; i < lins.size(); ++i) {
+    const instruction & inst = lins[i];
+    if (inst.oper == instruction::_LABEL) {
+      labelPos[inst.arg1] = i;
+      labels.insert(inst.arg1);
+    }
+    for (auto & u : inst.uses())
+      ++uses[u];
+    lastTemp = std::max(lastTemp, instruction::tempNumber(inst.arg1));
+    lastTemp = std::max(lastTemp, instruction::tempNumber(inst.arg2));
+    lastTemp = std::max(lastTemp, instruction::tempNumber(inst.arg3));
+  }
+  std::string entryLabel = "entry";
+  while (labels.count(entryLabel)) entryLabel = "_" + entryLabel;
+  bool jumpsToEntry = false;
+
+  // the sites are rewritten from the last one, so that the positions
+  // found for the previous ones stay valid
+  instructionList newLins = lins;
+  for (std::size_t c = lins.size(); c > 0; --c) {
+    const instruction & call = lins[c-1];
+    if (call.oper != instruction::_CALL) continue;
+    std::string callee = call.arg1;
+    bool self = (callee == name);
+    if (self ? not selfOK : not tailOK) continue;
+    if (not self and not prog.has_subroutine(callee)) continue;
+    bool calleeFunction = self ? function : prog.get_subroutine(callee).isFunction();
+    if (calleeFunction != function) continue;
+    std::size_t n = self ? params.size() : prog.get_subroutine(callee).params.size() -
+                                           (calleeFunction ? 1 : 0);
+
+    // pushparams of this call (and the space for the result),
+    // skipping the ones of the calls made while computing the
+    // arguments
+    std::vector<std::size_t> pushes;
+    std::size_t want = n + (function ? 1 : 0);
+    std::size_t depth = 0;
+    bool ok = true;
+    for (std::size_t i = c-1; i > 0 and pushes.size() < want; --i) {
+      const instruction & inst = lins[i-1];
+      if (inst.oper == instruction::_LABEL or inst.isJump()) {
+        ok = false;
+        break;
+      }
+      if (inst.oper == instruction::_POP) ++depth;
+      else if (inst.oper == instruction::_PUSH) {
+        if (depth == 0) pushes.push_back(i-1);
+        else --depth;
+      }
+    }
+    if (not ok or pushes.size() != want) continue;
+    std::reverse(pushes.begin(), pushes.end());
+    if (function and not lins[pushes[0]].arg1.empty()) continue;
+
+    // popparams and the copy to _result, followed by the return
+    std::size_t next = c;
+    for (std::size_t m = 0; m < n and ok; ++m, ++next)
+      ok = next < lins.size() and lins[next].oper == instruction::_POP and
+           lins[next].arg1.empty();
+    if (ok and function) {
+      ok = next < lins.size() and lins[next].oper == instruction::_POP;
+      std::string t = ok ? lins[next].arg1 : "";
+      ++next;
+      if (ok and t != "_result") {
+        ok = instruction::isTemp(t) and uses[t] == 1 and next < lins.size() and
+             lins[next].oper == instruction::_LOAD and lins[next].arg1 == "_result" and
+             lins[next].arg2 == t;
+        ++next;
+      }
+    }
+    if (not ok or not leadsToReturn(lins, next, labelPos)) continue;
+
+    // the arguments pushed (without the space for the result)
+    std::vector<std::string> args;
+    for (std::size_t k = (function ? 1 : 0); k < pushes.size(); ++k)
+      args.push_back(lins[pushes[k]].arg1);
+
+    instructionList tail;
+    if (self) {
+      // parallel assignment of the parameters: arguments that are
+      // parameters are copied first
+      std::vector<std::string> values = args;
+      for (std::size_t k = 0; k < n; ++k)
+        if (values[k] != params[k] and
+            std::find(params.begin(), params.end(), values[k]) != params.end()) {
+          std::string temp = "%" + std::to_string(++lastTemp);
+          tail.push_back(instruction::LOAD(temp, values[k]));
+          values[k] = temp;
+        }
+      for (std::size_t k = 0; k < n; ++k)
+        if (values[k] != params[k])
+          tail.push_back(instruction::LOAD(params[k], values[k]));
+      for (auto & v : subr.vars)
+        if (lins.mayBeReadUninitialized(v.name))
+          tail.push_back(instruction::ILOAD(v.name, "0"));
+      tail.push_back(instruction::UJUMP(entryLabel));
+      jumpsToEntry = true;
+      ++selfCalls;
+    }
+    else {
+      for (auto & a : args)
+        tail.push_back(instruction::PUSH(a));
+      tail.push_back(instruction::TAILCALL(callee));
+      ++tailCalls;
+    }
+
+    // replace the call sequence, and remove its pushparams
+    newLins.erase(newLins.begin()+c-1, newLins.begin()+next);
+    newLins.insert(newLins.begin()+c-1, tail.begin(), tail.end());
+    for (std::size_t k = pushes.size(); k > 0; --k)
+      newLins.erase(newLins.begin()+pushes[k-1]);
+  }
+  if (jumpsToEntry)
+    newLins.insert(newLins.begin(), instruction::LABEL(entryLabel));
+  subr.set_instructions(newLins);
+}
+
+// ----------------------------------------------------------------------
+// statistics
+
+std::string TailCalls::dumpStats() const {
+  return "tailcall: self-recursive    " + std::to_string(selfCalls) + "\n" +
+         "tailcall: tailcall          " + std::to_string(tailCalls) + "\n";
+}
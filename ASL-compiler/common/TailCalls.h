@@ -0,0 +1,68 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    TailCalls - Tail-call and self-recursion elimination
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <string>
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Class TailCalls: finds the calls in tail position, i.e. the call
+// sequences generated by CodeGenVisitor
+//
+//     pushparam              (space for the result, functions only)
+//     pushparam x1 ... pushparam xn
+//     call f
+//     popparam ... popparam  (n times)
+//     popparam t             (functions only)
+//     _result = t            (functions only)
+//
+// followed (maybe through labels and gotos) by the return of the
+// subroutine, and
+//   - if f is the subroutine itself, replaces the sequence by the
+//     assignment of x1 ... xn to the parameters and a jump to the
+//     beginning of the subroutine, so that the recursion becomes a
+//     loop. Local variables start as 0 on each call in the VM: the
+//     ones that may be read before being written are reset before
+//     the jump. Subroutines with local arrays or taking the address
+//     of a parameter are left alone,
+//   - otherwise, with the extended instruction set, replaces it by
+//     pushparam x1 ... pushparam xn; tailcall f, which reuses the
+//     frame of the subroutine. Only when f is a function if and only
+//     if the subroutine is, and the subroutine does not take the
+//     address of any of its variables (which f could receive).
+
+class TailCalls {
+
+public:
+
+  // Constructor ('extended': tailcall can be generated)
+  TailCalls(bool extended = false);
+
+  // Eliminate the tail calls of all the subroutines of the program
+  void optimize(code & c);
+
+  // What has been done (one line per counter)
+  std::string dumpStats() const;
+
+private:
+
+  // whether tailcall can be generated
+  bool extended;
+  // self-recursive tail calls replaced by a jump
+  std::size_t selfCalls;
+  // other tail calls replaced by a tailcall
+  std::size_t tailCalls;
+
+  // Eliminate the tail calls of one subroutine ('prog' gives the callees)
+  void optimize(subroutine & subr, const code & prog);
+
+};  // class TailCalls
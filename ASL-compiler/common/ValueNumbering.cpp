@@ -0,0 +1,354 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    ValueNumbering - Local value numbering (common subexpression
+//                     elimination inside basic blocks) for t-code
+//
+//////////////////////////////////////////////////////////////////////
+
+#include "ValueNumbering.h"
+#include "CFG.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+// ======================================================================
+// Auxiliary functions and classes
+
+namespace {
+
+bool isCommutative(instruction::Operation oper) {
+  return oper == instruction::_ADD  or oper == instruction::_MUL or
+         oper == instruction::_EQ   or oper == instruction::_AND or
+         oper == instruction::_OR   or oper == instruction::_FADD or
+         oper == instruction::_FMUL or oper == instruction::_FEQ or
+         oper == instruction::_NE   or oper == instruction::_FNE;
+}
+
+// An operand read by an instruction. Array bases (a in a[i], p in *p)
+// are addresses: a local array name can not be replaced, and a pointer
+// can only be replaced by a temporal (the VM only indexes through
+// local arrays and temporals)
+struct Operand {
+  std::string * name;
+  bool          base;
+};
+
+std::vector<Operand> operands(instruction & inst) {
+  std::vector<Operand> ops;
+  switch (inst.oper) {
+  case instruction::_FJUMP :
+  case instruction::_PUSH :
+  case instruction::_CHECK :
+  case instruction::_WRITEI :
+  case instruction::_WRITEF :
+  case instruction::_WRITEC : {
+    if (not inst.arg1.empty()) ops.push_back(Operand{&inst.arg1, false});
+    break;
+  }
+  case instruction::_LOAD : {   // not when loading a literal
+    if (not inst.uses().empty()) ops.push_back(Operand{&inst.arg2, false});
+    break;
+  }
+  case instruction::_NOT :
+  case instruction::_NEG :
+  case instruction::_FNEG :
+  case instruction::_FLOAT : { ops.push_back(Operand{&inst.arg2, false}); break; }
+  case instruction::_LOADC : { ops.push_back(Operand{&inst.arg2, true}); break; }
+  case instruction::_CLOAD : {
+    ops.push_back(Operand{&inst.arg1, true});
+    ops.push_back(Operand{&inst.arg2, false});
+    break;
+  }
+  case instruction::_LOADX : {
+    ops.push_back(Operand{&inst.arg2, true});
+    ops.push_back(Operand{&inst.arg3, false});
+    break;
+  }
+  case instruction::_XLOAD : {
+    ops.push_back(Operand{&inst.arg1, true});
+    ops.push_back(Operand{&inst.arg2, false});
+    ops.push_back(Operand{&inst.arg3, false});
+    break;
+  }
+  case instruction::_MEMCPY : {
+    ops.push_back(Operand{&inst.arg1, true});
+    ops.push_back(Operand{&inst.arg2, true});
+    break;
+  }
+  case instruction::_IFEQ :  case instruction::_IFNE :  case instruction::_IFLT :
+  case instruction::_IFLE :  case instruction::_IFGT :  case instruction::_IFGE :
+  case instruction::_IFFEQ : case instruction::_IFFNE : case instruction::_IFFLT :
+  case instruction::_IFFLE : case instruction::_IFFGT : case instruction::_IFFGE : {
+    ops.push_back(Operand{&inst.arg1, false});
+    ops.push_back(Operand{&inst.arg2, false});
+    break;
+  }
+  case instruction::_ADD :  case instruction::_SUB :  case instruction::_MUL :
+  case instruction::_DIV :  case instruction::_AND :  case instruction::_OR :
+  case instruction::_EQ :   case instruction::_LT :   case instruction::_LE :
+  case instruction::_FADD : case instruction::_FSUB : case instruction::_FMUL :
+  case instruction::_FDIV : case instruction::_FEQ :  case instruction::_FLT :
+  case instruction::_FLE :  case instruction::_MOD :  case instruction::_NE :
+  case instruction::_GT :   case instruction::_GE :   case instruction::_FNE :
+  case instruction::_FGT :  case instruction::_FGE : {
+    ops.push_back(Operand{&inst.arg2, false});
+    ops.push_back(Operand{&inst.arg3, false});
+    break;
+  }
+  default : break;   // in a1 = &a2, a2 must stay as it is
+  }
+  return ops;
+}
+
+// Value numbers of the names and expressions seen so far in a block
+class BlockValues {
+
+public:
+
+  // An already computed expression: its value number and, for array
+  // reads, the memory it depends on ("" if none, a local array name,
+  // or "*" for memory accessed through pointers)
+  struct Expr {
+    int         vn;
+    std::string mem;
+  };
+
+  // expression key -> value
+  std::unordered_map<std::string, Expr> exprs;
+
+  BlockValues() : nextVN(0) {}
+
+  // value number currently held by a name (a new one if not seen yet)
+  int number(const std::string & name) {
+    auto it = vnOf.find(name);
+    if (it != vnOf.end()) return it->second;
+    int v = fresh();
+    define(name, v);
+    return v;
+  }
+
+  int fresh() { return nextVN++; }
+
+  void define(const std::string & name, int v) {
+    vnOf[name] = v;
+    holders[v].push_back(name);
+  }
+
+  // oldest name still holding value v ("" if none)
+  std::string holder(int v, bool onlyTemps) const {
+    auto it = holders.find(v);
+    if (it == holders.end()) return "";
+    for (auto & name : it->second)
+      if (vnOf.at(name) == v and (not onlyTemps or instruction::isTemp(name)))
+        return name;
+    return "";
+  }
+
+  // forget array reads that may be changed by a write to memory 'mem'
+  // ("" forgets all of them)
+  void forget(const std::string & mem, const std::set<std::string> & addressTaken) {
+    for (auto it = exprs.begin(); it != exprs.end(); ) {
+      const std::string & m = it->second.mem;
+      bool alias = not m.empty() and
+                   (mem.empty() or m == mem or
+                    (mem == "*" and addressTaken.count(m)) or
+                    (m == "*" and addressTaken.count(mem)));
+      if (alias) it = exprs.erase(it);
+      else       ++it;
+    }
+  }
+
+private:
+
+  int nextVN;
+  std::map<std::string, int> vnOf;
+  std::map<int, std::vector<std::string>> holders;
+
+};  // class BlockValues
+
+}  // namespace
+
+
+// ======================================================================
+// class ValueNumbering
+
+// ----------------------------------------------------------------------
+// constructor
+
+ValueNumbering::ValueNumbering() :
+  redundant(0), propagated(0), removed(0) {
+}
+
+// ----------------------------------------------------------------------
+// optimization
+
+void ValueNumbering::optimize(code & c) {
+  for (auto & subr : c.get_subroutines())
+    optimize(subr);
+}
+
+void ValueNumbering::optimize(subroutine & subr) {
+  instructionList lins = subr.get_instructions();
+  std::set<std::string> localVars, addressTaken;
+  for (auto & v : subr.vars)
+    localVars.insert(v.name);
+  for (auto & inst : lins)
+    if (inst.oper == instruction::_ALOAD) addressTaken.insert(inst.arg2);
+
+  CFG cfg(lins);
+  for (std::size_t b = 0; b < cfg.getNumBlocks(); ++b)
+    numberBlock(lins, cfg.getBlock(b).first, cfg.getBlock(b).last,
+                localVars, addressTaken);
+  removeDeadTemps(lins);
+  subr.set_instructions(lins);
+}
+
+void ValueNumbering::numberBlock(instructionList & lins, std::size_t first, std::size_t last,
+                                 const std::set<std::string> & localVars,
+                                 const std::set<std::string> & addressTaken) {
+  BlockValues vals;
+  for (std::size_t pos = first; pos < last; ++pos) {
+    instruction & inst = lins[pos];
+
+    // use the oldest name holding the value of each operand
+    for (auto & op : operands(inst)) {
+      if (op.base and not instruction::isTemp(*op.name)) continue;
+      std::string h = vals.holder(vals.number(*op.name), op.base);
+      if (not h.empty() and h != *op.name) {
+        *op.name = h;
+        ++propagated;
+      }
+    }
+
+    // key of the expression computed by the instruction (if any)
+    std::string key, mem;
+    std::string op = std::to_string(inst.oper) + ":";
+    switch (inst.oper) {
+    case instruction::_LOAD : {
+      if (inst.uses().empty())   // literal, same as an ILOAD
+        key = std::to_string(instruction::_ILOAD) + ":" + inst.arg2;
+      else
+        vals.define(inst.arg1, vals.number(inst.arg2));
+      break;
+    }
+    case instruction::_ILOAD :
+    case instruction::_FLOAD :
+    case instruction::_CHLOAD : { key = op + inst.arg2; break; }
+    case instruction::_NOT :
+    case instruction::_NEG :
+    case instruction::_FNEG :
+    case instruction::_FLOAT :
+    case instruction::_ALOAD : { key = op + std::to_string(vals.number(inst.arg2)); break; }
+    case instruction::_LOADC : {
+      key = op + std::to_string(vals.number(inst.arg2));
+      mem = "*";
+      break;
+    }
+    case instruction::_LOADX : {
+      key = op + std::to_string(vals.number(inst.arg2)) + ":" +
+                 std::to_string(vals.number(inst.arg3));
+      mem = localVars.count(inst.arg2) ? inst.arg2 : "*";
+      break;
+    }
+    case instruction::_XLOAD : {
+      // the write changes the array, but then a[i] is known to be the value
+      mem = localVars.count(inst.arg1) ? inst.arg1 : "*";
+      vals.forget(mem, addressTaken);
+      std::string readKey = std::to_string(instruction::_LOADX) + ":" +
+                            std::to_string(vals.number(inst.arg1)) + ":" +
+                            std::to_string(vals.number(inst.arg2));
+      vals.exprs[readKey] = BlockValues::Expr{vals.number(inst.arg3), mem};
+      break;
+    }
+    case instruction::_CLOAD : { vals.forget("*", addressTaken); break; }
+    case instruction::_MEMCPY : {
+      vals.forget(localVars.count(inst.arg1) ? inst.arg1 : "*", addressTaken);
+      break;
+    }
+    case instruction::_CALL :  { vals.forget("", addressTaken); break; }
+    case instruction::_POP :
+    case instruction::_READI :
+    case instruction::_READF :
+    case instruction::_READC : {
+      if (not inst.arg1.empty()) vals.define(inst.arg1, vals.fresh());
+      break;
+    }
+    case instruction::_ADD :  case instruction::_SUB :  case instruction::_MUL :
+    case instruction::_DIV :  case instruction::_AND :  case instruction::_OR :
+    case instruction::_EQ :   case instruction::_LT :   case instruction::_LE :
+    case instruction::_FADD : case instruction::_FSUB : case instruction::_FMUL :
+    case instruction::_FDIV : case instruction::_FEQ :  case instruction::_FLT :
+    case instruction::_FLE :  case instruction::_MOD :  case instruction::_NE :
+    case instruction::_GT :   case instruction::_GE :   case instruction::_FNE :
+    case instruction::_FGT :  case instruction::_FGE : {
+      int v2 = vals.number(inst.arg2), v3 = vals.number(inst.arg3);
+      if (isCommutative(inst.oper) and v3 < v2) std::swap(v2, v3);
+      key = op + std::to_string(v2) + ":" + std::to_string(v3);
+      break;
+    }
+    default : break;
+    }
+    if (key.empty()) continue;
+
+    // reuse the value if it has already been computed (if no name
+    // holds it anymore, keep at least its value number so that the
+    // expressions using it are still recognized)
+    auto it = vals.exprs.find(key);
+    if (it != vals.exprs.end()) {
+      int v = it->second.vn;
+      std::string h = vals.holder(v, false);
+      if (not h.empty()) {
+        inst = instruction::LOAD(inst.arg1, h);
+        ++redundant;
+      }
+      vals.define(inst.arg1, v);
+      continue;
+    }
+    int v = vals.fresh();
+    vals.define(inst.arg1, v);
+    vals.exprs[key] = BlockValues::Expr{v, mem};
+  }
+}
+
+void ValueNumbering::removeDeadTemps(instructionList & lins) {
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    std::map<std::string, std::size_t> uses;
+    for (auto & inst : lins)
+      for (auto & name : inst.uses())
+        ++uses[name];
+    instructionList kept;
+    for (auto & inst : lins) {
+      std::string d = inst.defines();
+      bool sideEffects = inst.oper == instruction::_POP   or
+                         inst.oper == instruction::_READI or
+                         inst.oper == instruction::_READF or
+                         inst.oper == instruction::_READC;
+      bool selfCopy = inst.oper == instruction::_LOAD and inst.arg1 == inst.arg2;
+      if (selfCopy or (instruction::isTemp(d) and not uses.count(d) and not sideEffects)) {
+        ++removed;
+        changed = true;
+      }
+      else
+        kept.push_back(inst);
+    }
+    lins = kept;
+  }
+}
+
+// ----------------------------------------------------------------------
+// statistics
+
+std::string ValueNumbering::dumpStats() const {
+  return "lvn: redundant              " + std::to_string(redundant) + "\n" +
+         "lvn: propagated             " + std::to_string(propagated) + "\n" +
+         "lvn: dead removed           " + std::to_string(removed) + "\n";
+}
@@ -0,0 +1,69 @@
+//////////////////////////////////////////////////////////////////////
+//
+//    ValueNumbering - Local value numbering (common subexpression
+//                     elimination inside basic blocks) for t-code
+//
+//////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "code.h"
+
+#include <set>
+#include <string>
+#include <cstddef>    // std::size_t
+
+// using namespace std;
+
+
+//////////////////////////////////////////////////////////////////////
+// Class ValueNumbering: gives a value number to every name defined
+// in a basic block and keeps a hash table of the expressions already
+// computed (operation + value numbers of the operands). When an
+// expression is found again, the instruction becomes a copy of the
+// name that still holds the value, and later operands in the block
+// are replaced by that name. Temporals left without uses are then
+// removed from the whole subroutine.
+//
+// Array reads (x = a[i], x = *p) depend on memory, so they are
+// forgotten when memory may change:
+//   - a[i] = x  forgets reads of the local array a (and of any
+//               pointer if the address of a is taken in the subroutine),
+//   - p[i] = x, *p = x  (p pointer) forget reads through pointers
+//               and of local arrays whose address is taken,
+//   - memcpy    is a write to the whole destination array,
+//   - call      forgets all of them.
+
+class ValueNumbering {
+
+public:
+
+  // Constructor
+  ValueNumbering();
+
+  // Optimize all the subroutines of the program
+  void optimize(code & c);
+  // Optimize a single subroutine
+  void optimize(subroutine & subr);
+
+  // What has been done (one line per counter)
+  std::string dumpStats() const;
+
+private:
+
+  // expressions replaced by a copy of a previous value
+  std::size_t redundant;
+  // operands replaced by another name holding the same value
+  std::size_t propagated;
+  // instructions removed because they define unused temporals
+  std::size_t removed;
+
+  // Value numbering of the instructions in positions [first, last)
+  void numberBlock(instructionList & lins, std::size_t first, std::size_t last,
+                   const std::set<std::string> & localVars,
+                   const std::set<std::string> & addressTaken);
+
+  // Remove the instructions that only compute unused temporals
+  void removeDeadTemps(instructionList & lins);
+
+};  // class ValueNumbering
@@ -27,6 +27,9 @@
 ////////////////////////////////////////////////////////////////
 
 #include <iostream>
+#include <cctype>
+#include <cstdlib>
+#include <algorithm>
 #include "code.h"
 
 using namespace std;
@@ -41,6 +44,7 @@ instruction::instruction(Operation op,
   arg1 = a1;
   arg2 = a2;
   arg3 = a3;
+  line = 0;
 }
 
 instruction instruction::LABEL(const std::string &a1) { return instruction(_LABEL, a1); }
@@ -79,6 +83,26 @@ instruction instruction::LOADX(const std::string &a1, const std::string &a2, con
 instruction instruction::ALOAD(const std::string &a1, const std::string &a2) { return instruction(_ALOAD, a1, a2); }
 instruction instruction::LOADC(const std::string &a1, const std::string &a2) { return instruction(_LOADC, a1, a2); }
 instruction instruction::CLOAD(const std::string &a1, const std::string &a2) { return instruction(_CLOAD, a1, a2); }
+instruction instruction::MEMCPY(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_MEMCPY, a1, a2, a3); }
+instruction instruction::IFEQ(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_IFEQ, a1, a2, a3); }
+instruction instruction::IFNE(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_IFNE, a1, a2, a3); }
+instruction instruction::IFLT(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_IFLT, a1, a2, a3); }
+instruction instruction::IFLE(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_IFLE, a1, a2, a3); }
+instruction instruction::IFGT(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_IFGT, a1, a2, a3); }
+instruction instruction::IFGE(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_IFGE, a1, a2, a3); }
+instruction instruction::IFFEQ(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_IFFEQ, a1, a2, a3); }
+instruction instruction::IFFNE(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_IFFNE, a1, a2, a3); }
+instruction instruction::IFFLT(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_IFFLT, a1, a2, a3); }
+instruction instruction::IFFLE(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_IFFLE, a1, a2, a3); }
+instruction instruction::IFFGT(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_IFFGT, a1, a2, a3); }
+instruction instruction::IFFGE(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_IFFGE, a1, a2, a3); }
+instruction instruction::MOD(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_MOD, a1, a2, a3); }
+instruction instruction::NE(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_NE, a1, a2, a3); }
+instruction instruction::GT(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_GT, a1, a2, a3); }
+instruction instruction::GE(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_GE, a1, a2, a3); }
+instruction instruction::FNE(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FNE, a1, a2, a3); }
+instruction instruction::FGT(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FGT, a1, a2, a3); }
+instruction instruction::FGE(const std::string &a1, const std::string &a2, const std::string &a3) { return instruction(_FGE, a1, a2, a3); }
 instruction instruction::READI(const std::string &a1) { return instruction(_READI, a1); }
 instruction instruction::READF(const std::string &a1) { return instruction(_READF, a1); }
 instruction instruction::READC(const std::string &a1) { return instruction(_READC, a1); }
@@ -86,12 +110,189 @@ instruction instruction::WRITEI(const std::string &a1) { return instruction(_WRI
 instruction instruction::WRITEF(const std::string &a1) { return instruction(_WRITEF, a1); }
 instruction instruction::WRITEC(const std::string &a1) { return instruction(_WRITEC, a1); }
 instruction instruction::WRITELN() { return instruction(_WRITELN); }
+instruction instruction::WRITES(const std::string &a1) { return instruction(_WRITES, a1); }
+instruction instruction::TAILCALL(const std::string &a1) { return instruction(_TAILCALL, a1); }
+instruction instruction::CHECK(const std::string &a1, const std::string &a2) { return instruction(_CHECK, a1, a2); }
 instruction instruction::NOOP() { return instruction(_NOOP); }
 
 
 /// Destructor
 instruction::~instruction() {}
 
+/// kind of an operand: a character between single quotes, a number
+/// (maybe negative, float if it has a decimal point) or a name
+instruction::OperandKind instruction::operandKind(const string &arg) {
+  if (arg.size() > 2 and arg[0] == '\'' and arg[arg.size()-1] == '\'')
+    return instruction::_CHARIMM;
+  size_t i = (not arg.empty() and arg[0] == '-') ? 1 : 0;
+  if (i >= arg.size() or not isdigit(arg[i]))
+    return instruction::_NAME;
+  if (arg.find('.') == string::npos)
+    return instruction::_INTIMM;
+  return instruction::_FLOATIMM;
+}
+
+bool instruction::isImmediate(const string &arg) {
+  return operandKind(arg) != instruction::_NAME;
+}
+
+bool instruction::isTemp(const string &name) {
+  return not name.empty() and name[0] == '%';
+}
+
+int instruction::tempNumber(const string &name) {
+  if (not isTemp(name) or name.size() < 2) return 0;
+  for (size_t i = 1; i < name.size(); ++i)
+    if (not isdigit(name[i])) return 0;
+  return atoi(name.c_str()+1);
+}
+
+vector<string> instruction::uses() const {
+  vector<string> u;
+  switch (oper) {
+  case instruction::_FJUMP :
+  case instruction::_PUSH :
+  case instruction::_CHECK :
+  case instruction::_WRITEI :
+  case instruction::_WRITEF :
+  case instruction::_WRITEC : { if (not arg1.empty()) u.push_back(arg1); break; }
+  case instruction::_LOAD :
+  case instruction::_NOT :
+  case instruction::_NEG :
+  case instruction::_FNEG :
+  case instruction::_FLOAT :
+  case instruction::_ALOAD :
+  case instruction::_LOADC : { u.push_back(arg2); break; }
+  case instruction::_CLOAD : { u.push_back(arg1); u.push_back(arg2); break; }
+  case instruction::_XLOAD : { u.push_back(arg1); u.push_back(arg2); u.push_back(arg3); break; }
+  case instruction::_MEMCPY :
+  case instruction::_IFEQ :  case instruction::_IFNE :  case instruction::_IFLT :
+  case instruction::_IFLE :  case instruction::_IFGT :  case instruction::_IFGE :
+  case instruction::_IFFEQ : case instruction::_IFFNE : case instruction::_IFFLT :
+  case instruction::_IFFLE : case instruction::_IFFGT : case instruction::_IFFGE : {
+    u.push_back(arg1); u.push_back(arg2); break;
+  }
+  case instruction::_LOADX :
+  case instruction::_ADD :
+  case instruction::_SUB :
+  case instruction::_MUL :
+  case instruction::_DIV :
+  case instruction::_AND :
+  case instruction::_OR :
+  case instruction::_EQ :
+  case instruction::_LT :
+  case instruction::_LE :
+  case instruction::_FADD :
+  case instruction::_FSUB :
+  case instruction::_FMUL :
+  case instruction::_FDIV :
+  case instruction::_FEQ :
+  case instruction::_FLT :
+  case instruction::_FLE :
+  case instruction::_MOD :
+  case instruction::_NE :
+  case instruction::_GT :
+  case instruction::_GE :
+  case instruction::_FNE :
+  case instruction::_FGT :
+  case instruction::_FGE : { u.push_back(arg2); u.push_back(arg3); break; }
+  default : break;
+  }
+  // literals (e.g. the 1 in %3 = 1) and immediates are not names
+  u.erase(remove_if(u.begin(), u.end(), isImmediate), u.end());
+  return u;
+}
+
+string instruction::defines() const {
+  switch (oper) {
+  case instruction::_LABEL :
+  case instruction::_UJUMP :
+  case instruction::_FJUMP :
+  case instruction::_PUSH :
+  case instruction::_CALL :
+  case instruction::_RETURN :
+  case instruction::_TAILCALL :
+  case instruction::_CHECK :
+  case instruction::_XLOAD :
+  case instruction::_CLOAD :
+  case instruction::_MEMCPY :
+  case instruction::_IFEQ :  case instruction::_IFNE :  case instruction::_IFLT :
+  case instruction::_IFLE :  case instruction::_IFGT :  case instruction::_IFGE :
+  case instruction::_IFFEQ : case instruction::_IFFNE : case instruction::_IFFLT :
+  case instruction::_IFFLE : case instruction::_IFFGT : case instruction::_IFFGE :
+  case instruction::_WRITEI :
+  case instruction::_WRITEF :
+  case instruction::_WRITEC :
+  case instruction::_WRITELN :
+  case instruction::_WRITES :
+  case instruction::_NOOP :
+  case instruction::_INVALID : return "";
+  default : return arg1;   // popparam with no argument also gives ""
+  }
+}
+
+bool instruction::isJump() const {
+  return oper == instruction::_UJUMP or isReturn() or isCondJump();
+}
+
+bool instruction::isReturn() const {
+  return oper == instruction::_RETURN or oper == instruction::_TAILCALL;
+}
+
+bool instruction::isCondJump() const {
+  return oper == instruction::_FJUMP or
+         (oper >= instruction::_IFEQ and oper <= instruction::_IFFGE);
+}
+
+string instruction::jumpTarget() const {
+  if (oper == instruction::_UJUMP) return arg1;
+  if (oper == instruction::_FJUMP) return arg2;
+  if (isCondJump())                return arg3;
+  return "";
+}
+
+void instruction::setJumpTarget(const string &label) {
+  if (oper == instruction::_UJUMP)      arg1 = label;
+  else if (oper == instruction::_FJUMP) arg2 = label;
+  else if (isCondJump())                arg3 = label;
+}
+
+instruction::Operation instruction::negatedJump(Operation oper) {
+  switch (oper) {
+  case instruction::_IFEQ :  return instruction::_IFNE;
+  case instruction::_IFNE :  return instruction::_IFEQ;
+  case instruction::_IFLT :  return instruction::_IFGE;
+  case instruction::_IFGE :  return instruction::_IFLT;
+  case instruction::_IFLE :  return instruction::_IFGT;
+  case instruction::_IFGT :  return instruction::_IFLE;
+  case instruction::_IFFEQ : return instruction::_IFFNE;
+  case instruction::_IFFNE : return instruction::_IFFEQ;
+  case instruction::_IFFLT : return instruction::_IFFGE;
+  case instruction::_IFFGE : return instruction::_IFFLT;
+  case instruction::_IFFLE : return instruction::_IFFGT;
+  case instruction::_IFFGT : return instruction::_IFFLE;
+  default :                  return instruction::_INVALID;
+  }
+}
+
+instruction::Operation instruction::negatedCompare(Operation oper) {
+  switch (oper) {
+  case instruction::_EQ :  return instruction::_NE;
+  case instruction::_NE :  return instruction::_EQ;
+  case instruction::_LT :  return instruction::_GE;
+  case instruction::_GE :  return instruction::_LT;
+  case instruction::_LE :  return instruction::_GT;
+  case instruction::_GT :  return instruction::_LE;
+  case instruction::_FEQ : return instruction::_FNE;
+  case instruction::_FNE : return instruction::_FEQ;
+  case instruction::_FLT : return instruction::_FGE;
+  case instruction::_FGE : return instruction::_FLT;
+  case instruction::_FLE : return instruction::_FGT;
+  case instruction::_FGT : return instruction::_FLE;
+  default :                return instruction::_INVALID;
+  }
+}
+
 string instruction::dump() const {
   string s;
   string ind="   ";
@@ -106,12 +307,26 @@ string instruction::dump() const {
   case instruction::_PUSH : { s = "pushparam " + (arg1.empty()? "" : arg1); break; }
   case instruction::_POP : { s = "popparam " + (arg1.empty()? "" : arg1); break; }
   case instruction::_CALL : { s = "call " + arg1; break; }
+  case instruction::_TAILCALL : { s = "tailcall " + arg1; break; }
   case instruction::_RETURN : { s = "return"; break; }
   case instruction::_XLOAD : { s = arg1 + "[" + arg2 + "] = " + arg3; break; }
   case instruction::_LOADX : { s = arg1 + " = " + arg2 + "[" + arg3 + "]"; break; }
   case instruction::_ALOAD : { s = arg1 + " = &" + arg2; break; }
   case instruction::_LOADC : { s = arg1 + " = *" + arg2; break; }
   case instruction::_CLOAD : { s = "*" + arg1 + " = " + arg2; break; }
+  case instruction::_MEMCPY : { s = "memcpy " + arg1 + " " + arg2 + " " + arg3; break; }
+  case instruction::_IFEQ : { s = "ifeq " + arg1 + " " + arg2 + " goto " + arg3; break; }
+  case instruction::_IFNE : { s = "ifne " + arg1 + " " + arg2 + " goto " + arg3; break; }
+  case instruction::_IFLT : { s = "iflt " + arg1 + " " + arg2 + " goto " + arg3; break; }
+  case instruction::_IFLE : { s = "ifle " + arg1 + " " + arg2 + " goto " + arg3; break; }
+  case instruction::_IFGT : { s = "ifgt " + arg1 + " " + arg2 + " goto " + arg3; break; }
+  case instruction::_IFGE : { s = "ifge " + arg1 + " " + arg2 + " goto " + arg3; break; }
+  case instruction::_IFFEQ : { s = "iffeq " + arg1 + " " + arg2 + " goto " + arg3; break; }
+  case instruction::_IFFNE : { s = "iffne " + arg1 + " " + arg2 + " goto " + arg3; break; }
+  case instruction::_IFFLT : { s = "ifflt " + arg1 + " " + arg2 + " goto " + arg3; break; }
+  case instruction::_IFFLE : { s = "iffle " + arg1 + " " + arg2 + " goto " + arg3; break; }
+  case instruction::_IFFGT : { s = "iffgt " + arg1 + " " + arg2 + " goto " + arg3; break; }
+  case instruction::_IFFGE : { s = "iffge " + arg1 + " " + arg2 + " goto " + arg3; break; }
   case instruction::_READI : { s = "readi " + arg1; break; }
   case instruction::_READF : { s = "readf " + arg1; break; }
   case instruction::_READC : { s = "readc " + arg1; break; }
@@ -119,6 +334,8 @@ string instruction::dump() const {
   case instruction::_WRITEF : { s = "writef " + arg1; break; }
   case instruction::_WRITEC : { s = "writec " + arg1; break; }
   case instruction::_WRITELN : { s = "writeln"; break; }
+  case instruction::_WRITES : { s = "writes " + arg1; break; }
+  case instruction::_CHECK : { s = "check " + arg1 + " " + arg2; break; }
   case instruction::_ADD : { s = arg1 + " = " + arg2 + " + " + arg3; break; }
   case instruction::_SUB : { s = arg1 + " = " + arg2 + " - " + arg3; break; }
   case instruction::_MUL : { s = arg1 + " = " + arg2 + " * " + arg3; break; }
@@ -137,6 +354,13 @@ string instruction::dump() const {
   case instruction::_FEQ : { s = arg1 + " = " + arg2 + " ==. " + arg3; break; }
   case instruction::_FLT : { s = arg1 + " = " + arg2 + " <. " + arg3; break; }
   case instruction::_FLE : { s =  arg1 + " = " + arg2 + " <=. " + arg3; break; }
+  case instruction::_MOD : { s = arg1 + " = " + arg2 + " % " + arg3; break; }
+  case instruction::_NE : { s = arg1 + " = " + arg2 + " != " + arg3; break; }
+  case instruction::_GT : { s = arg1 + " = " + arg2 + " > " + arg3; break; }
+  case instruction::_GE : { s = arg1 + " = " + arg2 + " >= " + arg3; break; }
+  case instruction::_FNE : { s = arg1 + " = " + arg2 + " !=. " + arg3; break; }
+  case instruction::_FGT : { s = arg1 + " = " + arg2 + " >. " + arg3; break; }
+  case instruction::_FGE : { s = arg1 + " = " + arg2 + " >=. " + arg3; break; }
   case instruction::_FNEG : { s =  arg1 + " = -. " + arg2; break; }
   case instruction::_FLOAT : { s = arg1 + " = float " + arg2; break; }
   case instruction::_NOOP : { s = "noop"; break; }
@@ -171,6 +395,20 @@ instructionList instructionList::operator||(const instructionList &lst) const {
   return newlist;
 }
 
+// whether the variable v may be read before being written
+bool instructionList::mayBeReadUninitialized(const string &v) const {
+  for (auto & inst : *this) {
+    if (inst.oper == instruction::_LABEL or inst.isJump()) break;
+    for (auto & name : inst.uses())
+      if (name == v) return true;
+    if (inst.defines() == v) return false;
+  }
+  for (auto & inst : *this)
+    for (auto & name : inst.uses())
+      if (name == v) return true;
+  return false;
+}
+
 // print instructionList (for debugging)
 string instructionList::dump() const {
   string s;  
@@ -226,8 +464,11 @@ void subroutine::add_instructions(const instructionList &lins) {
 /// set instruction list (overwritting current instructions)
 void subroutine::set_instructions(const instructionList &lins) {
   instructions.clear();
+  labels.clear();
   this->add_instructions(lins);
 }
+/// get current instruction list
+const instructionList & subroutine::get_instructions() const { return instructions; }
 /// get instruction at given program counter
 instruction subroutine::get_instruction_at(size_t pc) const {
   if (pc>=instructions.size()) return instruction(instruction::_INVALID);
@@ -235,6 +476,12 @@ instruction subroutine::get_instruction_at(size_t pc) const {
 }
 /// get program counter for given label
 size_t subroutine::get_label_pc(std::string &lab) const { return labels.find(lab)->second; }
+/// whether it is a function (it has a "_result" parameter)
+bool subroutine::isFunction() const {
+  for (auto & p : params)
+    if (p.name == "_result") return true;
+  return false;
+}
 /// print (for debugging)
 string subroutine::dump() const {
   string s;
@@ -272,32 +519,93 @@ const subroutine& code::get_subroutine(const string &name) const {
   size_t p = names.find(name)->second;
   return subs[p];
 }
+/// check whether a subroutine exists
+bool code::has_subroutine(const string &name) const {
+  return names.find(name) != names.end();
+}
 /// add subroutine
 void code::add_subroutine(const subroutine &s) {
   subs.push_back(s);
   names.insert(make_pair(s.get_name(), subs.size()-1));
 }
+/// remove subroutine (the others keep their order)
+void code::remove_subroutine(const string &name) {
+  auto it = names.find(name);
+  if (it == names.end()) return;
+  subs.erase(subs.begin() + it->second);
+  names.clear();
+  for (size_t i = 0; i < subs.size(); ++i)
+    names.insert(make_pair(subs[i].get_name(), i));
+}
+/// get all subroutines
+vector<subroutine> & code::get_subroutines() { return subs; }
+const vector<subroutine> & code::get_subroutines() const { return subs; }
+/// add string to the pool
+string code::add_string(const string &s) {
+  size_t k = 0;
+  while (k < strings.size() and strings[k] != s) ++k;
+  if (k == strings.size()) strings.push_back(s);
+  return "$" + to_string(k);
+}
+/// get string pool
+const vector<string> & code::get_strings() const { return strings; }
+
+/// string in t-code text: between double quotes, with \n, \t, \" and
+/// \\ for newlines, tabs, double quotes and backslashes
+static string quoted(const string &s) {
+  string q = "\"";
+  for (char c : s) {
+    if (c == '\n')      q += "\\n";
+    else if (c == '\t') q += "\\t";
+    else if (c == '"')  q += "\\\"";
+    else if (c == '\\') q += "\\\\";
+    else                q += c;
+  }
+  return q + "\"";
+}
+
 /// print (for debugging)
 string code::dump() const {
   string c;
+  if (not strings.empty()) {
+    c += "strings\n";
+    for (size_t k = 0; k < strings.size(); ++k)
+      c += "  $" + to_string(k) + " " + quoted(strings[k]) + "\n";
+    c += "endstrings\n\n";
+  }
   for (auto s : subs) c += s.dump();
   return c;
 }
 
+/// print the source lines of the instructions (for the profiler)
+string code::dumpLines() const {
+  string c;
+  for (auto & s : subs) {
+    const instructionList & lins = s.get_instructions();
+    for (size_t pc = 0; pc < lins.size(); ++pc)
+      if (lins[pc].line != 0)
+        c += s.get_name() + " " + to_string(pc) + " " + to_string(lins[pc].line) + "\n";
+  }
+  return c;
+}
+
 
 ////////////////////////////////////////////////////////////////////
 /// Static methods to manage counters
 int counters::countIF = 0;
 int counters::countWHILE = 0;
+int counters::countCOND = 0;
 int counters::countTEMP = 0;
 
 string counters::newLabelIF() { return std::to_string(++countIF); }
 string counters::newLabelWHILE() { return std::to_string(++countWHILE); }
+string counters::newLabelCOND() { return std::to_string(++countCOND); }
 string counters::newTEMP() { return std::to_string(++countTEMP); }
 
 void counters::resetLabelIF() { countIF = 0; }
 void counters::resetLabelWHILE() { countWHILE = 0; }
+void counters::resetLabelCOND() { countCOND = 0; }
 void counters::resetTEMP() { countTEMP = 0; }
 
-void counters::resetLabels() { resetLabelIF(); resetLabelWHILE(); }
+void counters::resetLabels() { resetLabelIF(); resetLabelWHILE(); resetLabelCOND(); }
 void counters::reset() { resetLabels(); resetTEMP(); }
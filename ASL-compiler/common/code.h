@@ -31,6 +31,8 @@
 #include <map>
 #include <list>
 #include <vector>
+#include <string>
+#include <cstddef>
 
 /// predeclaration
 class instructionList;
@@ -45,12 +47,28 @@ public:
                 _ADD, _SUB, _MUL, _DIV, _EQ, _LT, _LE, _NEG, _NOT, _AND, _OR, _FLOAT,
                 _FADD, _FSUB, _FMUL, _FDIV, _FEQ, _FLT, _FLE, _FNEG,
                 _LOAD, _ILOAD, _CHLOAD, _FLOAD, _XLOAD, _LOADX, _ALOAD, _LOADC, _CLOAD,
-                _READI, _READF, _READC, _WRITEI, _WRITEF, _WRITEC, _WRITELN, _NOOP, _INVALID} Operation;
+                _READI, _READF, _READC, _WRITEI, _WRITEF, _WRITEC, _WRITELN,
+                // extended instruction set: not understood by the stock tvm
+                // (CodeGenVisitor only generates them with --isa=ext)
+                _MEMCPY,
+                _IFEQ, _IFNE, _IFLT, _IFLE, _IFGT, _IFGE,
+                _IFFEQ, _IFFNE, _IFFLT, _IFFLE, _IFFGT, _IFFGE,
+                _MOD, _NE, _GT, _GE, _FNE, _FGT, _FGE,
+                _WRITES, _TAILCALL, _CHECK,
+                _NOOP, _INVALID} Operation;
+
+  /// operand kinds: names (variables, temporals, labels, subroutines)
+  /// or, with the extended instruction set, immediate constants,
+  /// written as in ASL: 3, -3, 2.5, 'a', '\n'
+  typedef enum {_NAME, _INTIMM, _FLOATIMM, _CHARIMM} OperandKind;
   
   /// instruction code
   Operation oper;
   /// arguments
   std::string arg1, arg2, arg3;
+  /// line of the ASL source that generated the instruction (0 if
+  /// unknown, e.g. instructions created by the optimizer)
+  std::size_t line;
   
   /// constructor
   instruction(Operation op,
@@ -126,9 +144,11 @@ public:
   static instruction CHLOAD(const std::string &a1, const std::string &a2);
   // create new instruction "a1 = a2" (where a2 is a float constant)
   static instruction FLOAD(const std::string &a1, const std::string &a2);
-  // create new instruction "a1[a2] = a3" 
+  // create new instruction "a1[a2] = a3" (a1 a local array or a
+  // temporal holding the address of an array, or an array parameter
+  // [extended])
   static instruction XLOAD(const std::string &a1, const std::string &a2, const std::string &a3);
-  // create new instruction "a1 = a2[a3]" 
+  // create new instruction "a1 = a2[a3]" (a2 as a1 in XLOAD)
   static instruction LOADX(const std::string &a1, const std::string &a2, const std::string &a3);
   // create new instruction "a1 = &a2" 
   static instruction ALOAD(const std::string &a1, const std::string &a2);
@@ -136,6 +156,56 @@ public:
   static instruction LOADC(const std::string &a1, const std::string &a2);
   // create new instruction "*a1 = a2" 
   static instruction CLOAD(const std::string &a1, const std::string &a2);
+  // create new instruction "memcpy a1 a2 a3" (copy a3 elements, a3 an
+  // integer constant, from array a2 to array a1) [extended]
+  static instruction MEMCPY(const std::string &a1, const std::string &a2, const std::string &a3);
+  // create new instruction "ifeq a1 a2 goto a3" (jump to a3 if a1 == a2) [extended]
+  static instruction IFEQ(const std::string &a1, const std::string &a2, const std::string &a3);
+  // create new instruction "ifne a1 a2 goto a3" (jump to a3 if a1 != a2) [extended]
+  static instruction IFNE(const std::string &a1, const std::string &a2, const std::string &a3);
+  // create new instruction "iflt a1 a2 goto a3" (jump to a3 if a1 < a2) [extended]
+  static instruction IFLT(const std::string &a1, const std::string &a2, const std::string &a3);
+  // create new instruction "ifle a1 a2 goto a3" (jump to a3 if a1 <= a2) [extended]
+  static instruction IFLE(const std::string &a1, const std::string &a2, const std::string &a3);
+  // create new instruction "ifgt a1 a2 goto a3" (jump to a3 if a1 > a2) [extended]
+  static instruction IFGT(const std::string &a1, const std::string &a2, const std::string &a3);
+  // create new instruction "ifge a1 a2 goto a3" (jump to a3 if a1 >= a2) [extended]
+  static instruction IFGE(const std::string &a1, const std::string &a2, const std::string &a3);
+  // float versions of the above: "iffeq a1 a2 goto a3", ... [extended].
+  // iffne, iffgt and iffge jump exactly when iffeq, iffle and ifflt do
+  // not (so they also jump if an operand is not a number)
+  static instruction IFFEQ(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction IFFNE(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction IFFLT(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction IFFLE(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction IFFGT(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction IFFGE(const std::string &a1, const std::string &a2, const std::string &a3);
+  // create new instruction "a1 = a2 % a3" (remainder of a2 / a3, with
+  // the sign of a2) [extended]
+  static instruction MOD(const std::string &a1, const std::string &a2, const std::string &a3);
+  // create new instruction "a1 = a2 != a3" [extended]
+  static instruction NE(const std::string &a1, const std::string &a2, const std::string &a3);
+  // create new instruction "a1 = a2 > a3" [extended]
+  static instruction GT(const std::string &a1, const std::string &a2, const std::string &a3);
+  // create new instruction "a1 = a2 >= a3" [extended]
+  static instruction GE(const std::string &a1, const std::string &a2, const std::string &a3);
+  // create new instruction "a1 = a2 !=. a3", "a1 = a2 >. a3" and
+  // "a1 = a2 >=. a3" [extended]: the negations of ==., <=. and <.
+  // (so they are also true if an operand is not a number)
+  static instruction FNE(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FGT(const std::string &a1, const std::string &a2, const std::string &a3);
+  static instruction FGE(const std::string &a1, const std::string &a2, const std::string &a3);
+  // create new instruction "writes a1" (a1 = $k, write the string k
+  // of the string pool of the program) [extended]
+  static instruction WRITES(const std::string &a1);
+  // create new instruction "tailcall a1" (call a1 with the parameters
+  // pushed, and return: its result is the result of the current
+  // subroutine, whose frame can be reused) [extended]
+  static instruction TAILCALL(const std::string &a1);
+  // create new instruction "check a1 a2" (stop the program with an
+  // error if a1 is not in [0, a2), a2 an integer constant: bounds check
+  // of an index of an array of size a2) [extended]
+  static instruction CHECK(const std::string &a1, const std::string &a2);
   // create new instruction "readi a1" 
   static instruction READI(const std::string &a1);
   // create new instruction "readf a1" 
@@ -153,6 +223,37 @@ public:
   // create new instruction "noop" (not really needed) 
   static instruction NOOP();
   
+  // kind of an operand, given by its text
+  static OperandKind operandKind(const std::string &arg);
+  // whether the operand is an immediate constant (not a name)
+  static bool isImmediate(const std::string &arg);
+  // whether the name is a temporal ("%..."); codegen never reads them
+  // outside the expression that defines them, so they can be renamed
+  static bool isTemp(const std::string &name);
+  // number of a temporal generated by codegen ("%12" -> 12), 0 otherwise
+  static int tempNumber(const std::string &name);
+  // names read by the instruction (literal and immediate operands are
+  // not included)
+  std::vector<std::string> uses() const;
+  // name written by the instruction ("" if none)
+  std::string defines() const;
+  // whether the instruction transfers control (goto, ifFalse,
+  // compare-and-jump, return, tailcall)
+  bool isJump() const;
+  // whether the instruction leaves the subroutine (return, tailcall)
+  bool isReturn() const;
+  // whether the instruction is a conditional jump (ifFalse or a
+  // compare-and-jump)
+  bool isCondJump() const;
+  // label of a goto or conditional jump (and how to change it)
+  std::string jumpTarget() const;
+  void setJumpTarget(const std::string &label);
+  // compare-and-jump that jumps exactly when 'oper' does not
+  static Operation negatedJump(Operation oper);
+  // comparison whose result is the negation of the one of 'oper'
+  // (_INVALID if 'oper' is not a comparison)
+  static Operation negatedCompare(Operation oper);
+
   // print instruction
   std::string dump() const;   
 };
@@ -173,6 +274,10 @@ public:
   // concatenation of lists (or list+instruction, via automatic coertion)
   instructionList operator||(const instructionList &lst) const;
 
+  // whether the variable v may be read before being written: it is
+  // safe if it is written in the first block of the list before any use
+  bool mayBeReadUninitialized(const std::string &v) const;
+
   // print instructionList
   std::string dump() const;   
 };
@@ -231,11 +336,15 @@ public:
   void add_instructions(const instructionList &lins);
   /// set instruction list (overwritting current instructions)
   void set_instructions(const instructionList &lins);
+  /// get current instruction list
+  const instructionList & get_instructions() const;
   
   /// get instruction at given program counter in subroutine
   instruction get_instruction_at(size_t pc) const;
   /// get program counter in subroutine for given label
   size_t get_label_pc(std::string &lab) const;
+  /// whether it is a function (it has a "_result" parameter)
+  bool isFunction() const;
 
   // print subroutine (params, vars, and instructions)
   std::string dump() const;
@@ -250,6 +359,8 @@ private:
   std::vector<subroutine> subs;
   /// index to access subroutines by name
   std::map<std::string, size_t> names;
+  /// string pool (strings written by writes)
+  std::vector<std::string> strings;
   
 public:
   /// constructor and destructor
@@ -260,11 +371,27 @@ public:
   subroutine& get_last_subroutine();
   /// get subroutine by name
   const subroutine& get_subroutine(const std::string &name) const;
+  /// whether there is a subroutine with the given name
+  bool has_subroutine(const std::string &name) const;
   /// add new subroutine
   void add_subroutine(const subroutine &s);
+  /// remove a subroutine (e.g. one that is never called)
+  void remove_subroutine(const std::string &name);
+  /// get all subroutines (in order of addition), e.g. to optimize them
+  std::vector<subroutine> & get_subroutines();
+  const std::vector<subroutine> & get_subroutines() const;
+  /// add a string to the pool (if not there yet) and get its
+  /// reference ($k) for writes
+  std::string add_string(const std::string &s);
+  /// get the string pool, in order of addition
+  const std::vector<std::string> & get_strings() const;
 
   // print code (all info for all subroutines)
   std::string dump() const;
+  // print the source lines of the instructions, one "subroutine pc
+  // line" per instruction with a known line (pc is its position in the
+  // subroutine, as in the tvm traces)
+  std::string dumpLines() const;
 };
 
 
@@ -275,6 +402,7 @@ class counters {
 private:
   static int countIF;
   static int countWHILE;
+  static int countCOND;
   static int countTEMP;
 
 public:
@@ -282,14 +410,16 @@ public:
   // to ease concatenation with other literals (e.g. "labelIF" + "4" -> "LabelIF4")
   static std::string newLabelIF();
   static std::string newLabelWHILE();
+  static std::string newLabelCOND();
   static std::string newTEMP();
   
   // reset individual counters 
   static void resetLabelIF();
   static void resetLabelWHILE();
+  static void resetLabelCOND();
   static void resetTEMP();
   
-  // reset label counters (IF and WHILE)
+  // reset label counters (IF, WHILE and COND)
   static void resetLabels();
   // reset all counters (IF, WHILE, and TEMP)
   static void reset();
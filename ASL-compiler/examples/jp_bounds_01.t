@@ -0,0 +1,36 @@
+strings
+  $0 "\n"
+endstrings
+
+function main
+  vars
+    v 5
+    i 1
+    k 1
+  endvars
+
+     i = 0
+  label while1 :
+     ifge i 5 goto endWhile1
+     check i 5
+     %2 = i * 10
+     v[i] = %2
+     %3 = i + 1
+     i = %3
+     goto while1
+  label endWhile1 :
+     readi k
+     check k 5
+     %4 = v[k]
+     writei %4
+     writes $0
+     %6 = k + 3
+     k = %6
+     check k 5
+     %7 = v[k]
+     writei %7
+     writes $0
+     return
+endfunction
+
+
@@ -0,0 +1,41 @@
+strings
+  $0 " "
+  $1 "\n"
+endstrings
+
+function main
+  vars
+    v 10
+    i 1
+    n 1
+    k 1
+  endvars
+
+     n = 10
+     i = 0
+  label while1 :
+     ifge i n goto endWhile1
+     check i 10
+     %2 = i + 1
+     v[i] = %2
+     %3 = i + 1
+     i = %3
+     goto while1
+  label endWhile1 :
+     readi k
+     i = 0
+  label while2 :
+     ifge i k goto endWhile2
+     check i 10
+     %4 = v[i]
+     writei %4
+     writes $0
+     %6 = i + 1
+     i = %6
+     goto while2
+  label endWhile2 :
+     writes $1
+     return
+endfunction
+
+
@@ -0,0 +1,66 @@
+function isVowel
+  params
+    _result
+    c
+  endparams
+
+   %1 = 'a'
+   %2 = c == %1
+   %3 = 'e'
+   %4 = c == %3
+   %5 = %2 or %4
+   %6 = 'i'
+   %7 = c == %6
+   %8 = %5 or %7
+   %9 = 'o'
+   %10 = c == %9
+   %11 = %8 or %10
+   %12 = 'u'
+   %13 = c == %12
+   %14 = %11 or %13
+   _result = %14
+   return
+endfunction
+
+function main
+  vars
+    c 1
+    n 1
+    v 1
+  endvars
+
+     %1 = 0
+     n = %1
+     %2 = 0
+     v = %2
+     readc c
+  label while1 :
+     %3 = '.'
+     %5 = c == %3
+     %4 = not %5
+     ifFalse %4 goto endWhile1
+     %6 = 1
+     %7 = n + %6
+     n = %7
+     pushparam 
+     pushparam c
+     call isVowel
+     popparam 
+     popparam %8
+     ifFalse %8 goto endif1
+     %9 = 1
+     %10 = v + %9
+     v = %10
+  label endif1 :
+     readc c
+     goto while1
+  label endWhile1 :
+     writei n
+     %11 = ' '
+     writec %11
+     writei v
+     writeln
+     return
+endfunction
+
+
@@ -0,0 +1,154 @@
+function check
+  params
+    _result
+    v
+    i
+  endparams
+
+   %1 = 'c'
+   writec %1
+   %1 = 'h'
+   writec %1
+   %1 = 'e'
+   writec %1
+   %1 = 'c'
+   writec %1
+   %1 = 'k'
+   writec %1
+   %1 = ' '
+   writec %1
+   writei i
+   writeln
+   %4 = v
+   %3 = 1
+   %3 = i * %3
+   %6 = 1
+   %6 = i * %6
+   %7 = v
+   %5 = %7[%6]
+   %8 = 1
+   %9 = %5 + %8
+   %4[%3] = %9
+   %11 = 1
+   %11 = i * %11
+   %12 = v
+   %10 = %12[%11]
+   %13 = 1
+   %15 = %10 <= %13
+   %14 = not %15
+   _result = %14
+   return
+endfunction
+
+function main
+  vars
+    v 3
+    i 1
+    b 1
+  endvars
+
+     %2 = 0
+     %1 = 1
+     %1 = %2 * %1
+     %3 = 0
+     v[%1] = %3
+     %5 = 1
+     %4 = 1
+     %4 = %5 * %4
+     %6 = 1
+     v[%4] = %6
+     %8 = 2
+     %7 = 1
+     %7 = %8 * %7
+     %9 = 5
+     v[%7] = %9
+     %10 = 0
+     i = %10
+  label while1 :
+     %11 = 3
+     %12 = i < %11
+     ifFalse %12 goto endWhile1
+     %13 = 1
+     %14 = i == %13
+     pushparam 
+     %16 = &v
+     pushparam %16
+     pushparam i
+     call check
+     popparam 
+     popparam 
+     popparam %15
+     %17 = %14 or %15
+     ifFalse %17 goto endif1
+     %18 = 'y'
+     writec %18
+     %18 = 'e'
+     writec %18
+     %18 = 's'
+     writec %18
+     writeln
+  label endif1 :
+     %19 = 1
+     %21 = i == %19
+     %20 = not %21
+     pushparam 
+     %23 = &v
+     pushparam %23
+     pushparam i
+     call check
+     popparam 
+     popparam 
+     popparam %22
+     %24 = %20 and %22
+     ifFalse %24 goto endif2
+     %25 = 'b'
+     writec %25
+     %25 = 'o'
+     writec %25
+     %25 = 't'
+     writec %25
+     %25 = 'h'
+     writec %25
+     writeln
+  label endif2 :
+     %26 = 1
+     %27 = i + %26
+     i = %27
+     goto while1
+  label endWhile1 :
+     %28 = 0
+     pushparam 
+     %30 = &v
+     pushparam %30
+     %31 = 2
+     pushparam %31
+     call check
+     popparam 
+     popparam 
+     popparam %29
+     %32 = %28 and %29
+     b = %32
+     %33 = 0
+     %35 = 1
+     %35 = %33 * %35
+     %34 = v[%35]
+     writei %34
+     %36 = ' '
+     writec %36
+     %37 = 1
+     %39 = 1
+     %39 = %37 * %39
+     %38 = v[%39]
+     writei %38
+     %40 = ' '
+     writec %40
+     %41 = 2
+     %43 = 1
+     %43 = %41 * %43
+     %42 = v[%43]
+     writei %42
+     writeln
+     return
+endfunction
+
+